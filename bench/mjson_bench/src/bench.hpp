@@ -0,0 +1,125 @@
+//
+// Minimal benchmark harness for Mini Json parser
+//
+// Copyright(c) 2020 Alex Demyankov <alex.demyankov@gmail.com>
+// All rights reserved.
+//
+// Licensed under the MIT license; A copy of the license that can be
+// found in the LICENSE file.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+namespace bench {
+
+// Minimal time spent on every benchmark; --quick lowers it for smoke runs
+inline double min_time = 0.25;
+
+// Benchmarks whose name does not contain the filter are skipped
+inline std::string filter{};
+
+// Results are accumulated here so the measured code is not optimized away
+inline volatile size_t sink = 0;
+
+// Counted by the global operator new of the benchmark executable
+inline std::atomic<size_t> allocations{ 0 };
+
+// Peak resident set size since the last reset_peak_rss() in KB, from the
+// VmHWM line of /proc/self/status; 0 if not known
+inline size_t recent_peak_rss_kb() {
+    size_t kb = 0;
+#if defined(__linux__)
+    if (std::FILE* f = std::fopen("/proc/self/status", "r")) {
+        char line[256];
+        while (std::fgets(line, sizeof(line), f))
+            if (std::sscanf(line, "VmHWM: %zu kB", &kb) == 1) break;
+        std::fclose(f);
+    }
+#endif
+    return kb;
+}
+
+// The largest peak seen before a reset
+inline size_t earlier_peak_kb = 0;
+
+// Starts a new peak from the current resident set size, so the next
+// recent_peak_rss_kb() belongs to the work done in between; false where
+// the system cannot reset it (only Linux can)
+inline bool reset_peak_rss() {
+#if defined(__linux__)
+    earlier_peak_kb = std::max(earlier_peak_kb, recent_peak_rss_kb());
+    std::FILE* f = std::fopen("/proc/self/clear_refs", "w");
+    if (!f) return false;
+    const bool written = std::fputs("5", f) >= 0;
+    return std::fclose(f) == 0 && written;
+#else
+    return false;
+#endif
+}
+
+// Peak resident set size of the whole process in KB; 0 if not known
+inline size_t peak_rss_kb() {
+#if defined(_WIN32)
+    return 0;
+#else
+    struct rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+#if defined(__APPLE__)
+    const size_t kb = static_cast<size_t>(ru.ru_maxrss) / 1024;
+#else
+    const size_t kb = static_cast<size_t>(ru.ru_maxrss);
+#endif
+    return std::max({ kb, earlier_peak_kb, recent_peak_rss_kb() });
+#endif
+}
+
+inline bool enabled(const std::string& name) {
+    return name.find(filter) != std::string::npos;
+}
+
+inline void header(const char* title) {
+    std::printf("\n%s\n", title);
+    std::printf("%-48s %12s %14s %12s\n", "benchmark", "MB/s", "ns/op", "allocs/op");
+}
+
+// Runs f() until min_time is reached and prints the throughput for the
+// given number of bytes processed by a single call, and the number of heap
+// allocations made by a single call
+template <class F>
+void run(const std::string& name, size_t bytes, F&& f) {
+    using clock = std::chrono::steady_clock;
+    if (!enabled(name)) return;
+
+    sink += f();
+
+    size_t iterations = 1;
+    size_t allocs = 0;
+    double seconds = 0;
+    for (;;) {
+        const size_t count = allocations.load(std::memory_order_relaxed);
+        auto start = clock::now();
+        for (size_t i = 0; i < iterations; i++) sink += f();
+        seconds = std::chrono::duration<double>(clock::now() - start).count();
+        allocs = allocations.load(std::memory_order_relaxed) - count;
+
+        if (seconds >= min_time) break;
+        iterations *= seconds > 0 ? std::max<size_t>(2, static_cast<size_t>(min_time / seconds * 1.2)) : 10;
+    }
+
+    double ns = seconds * 1e9 / iterations;
+    double per_op = static_cast<double>(allocs) / iterations;
+    if (bytes) std::printf("%-48s %12.1f %14.0f %12.1f\n", name.c_str(), bytes * iterations / seconds / (1024 * 1024), ns, per_op);
+    else std::printf("%-48s %12s %14.0f %12.1f\n", name.c_str(), "-", ns, per_op);
+}
+
+} // namespace bench
@@ -0,0 +1,137 @@
+//
+// Generated inputs for the Mini Json parser benchmarks
+//
+// Copyright(c) 2020 Alex Demyankov <alex.demyankov@gmail.com>
+// All rights reserved.
+//
+// Licensed under the MIT license; A copy of the license that can be
+// found in the LICENSE file.
+//
+
+#pragma once
+
+#include <string>
+
+namespace corpora {
+
+// The configuration of the hello sample application
+inline const char* hello_config = R"({
+    "Device"    : "HeartMN1",
+    "ID"        : "PAMF-0119239.A1.PBS-09",
+    "Class"     : "Monitor",
+    "Type"      : "Wearable",
+    "Firmware" : {
+        "Version" : "1.123.900",
+        "Image"   : [ "PBS-09", "PBS-10", "PBS-10.A", "PBS-11" ],
+        "Update" : {
+            "Server"        : "https://update.firmware.com:8774/release",
+            "Connection"    : "mTLS",
+            "Client.Auth"   : [ "client1.der", "client2.der", "client3.der" ],
+            "Server.Auth"   : [ "server1.der", "server2.der" ]
+        },
+        "MD5" : "f598478b5c316be40c16893bee3c1282"
+    },
+    "Version"   : "1.9",
+    "Signature" : "e161fd8a6ca550425a9173eaf3c8fc1108280f9e"
+})";
+
+// Members with string values of the given length
+inline std::string long_strings(size_t count, size_t length) {
+    std::string s = "{\n";
+    for (size_t i = 0; i < count; i++) {
+        s += "    \"key" + std::to_string(i) + "\" : \"";
+        for (size_t j = 0; j < length; j++) s += static_cast<char>('a' + j % 26);
+        s += i + 1 < count ? "\",\n" : "\"\n";
+    }
+    return s + "}\n";
+}
+
+// Like long_strings, with an escape every 64 chars of a value
+inline std::string escaped_strings(size_t count, size_t length) {
+    std::string s = "{\n";
+    for (size_t i = 0; i < count; i++) {
+        s += "    \"key" + std::to_string(i) + "\" : \"";
+        for (size_t j = 0; j < length; j++) {
+            if (j % 64 == 63) s += j % 128 == 127 ? "\\u00e9" : "\\n";
+            else s += static_cast<char>('a' + j % 26);
+        }
+        s += i + 1 < count ? "\",\n" : "\"\n";
+    }
+    return s + "}\n";
+}
+
+// Members with short strings; every fourth one is a two item array
+inline std::string wide_object(size_t count) {
+    std::string s = "{";
+    for (size_t i = 0; i < count; i++) {
+        const std::string n = std::to_string(i);
+        s += i ? ", " : " ";
+        if (i % 4 == 3) s += "\"member" + n + "\" : [ \"a" + n + "\", \"b" + n + "\" ]";
+        else s += "\"member" + n + "\" : \"value" + n + "\"";
+    }
+    return s + " }";
+}
+
+// Objects nested up to the given depth, each with a couple of values
+inline std::string deep_object(size_t depth) {
+    std::string s;
+    for (size_t i = 0; i < depth; i++)
+        s += R"({ "level" : ")" + std::to_string(i) + R"(", "name" : "node", "child" : )";
+    s += "{ }";
+    for (size_t i = 0; i < depth; i++) s += " }";
+    return s;
+}
+
+// Members holding short arrays of short strings
+inline std::string short_arrays(size_t count) {
+    std::string s = "{";
+    for (size_t i = 0; i < count; i++) {
+        const std::string n = std::to_string(i);
+        s += i ? ",\n  " : "\n  ";
+        s += "\"list" + n + "\" : [ \"x\", \"y" + n + "\", \"z\" ]";
+    }
+    return s + "\n}";
+}
+
+// A few top-level members followed by many large nested objects
+inline std::string sparse_document(size_t count) {
+    std::string s = R"({ "Device" : "HeartMN1", "Version" : "1.9")";
+    for (size_t i = 0; i < count; i++) {
+        const std::string n = std::to_string(i);
+        s += ", \"object" + n + "\" : " + wide_object(64);
+    }
+    return s + " }";
+}
+
+// The i-th number of the numeric corpora: integers, decimals and exponents
+inline std::string numeric_value(size_t i) {
+    const std::string n = std::to_string(i % 1000);
+    switch (i % 4) {
+    case 0: return std::to_string(i * 7919 % 1000003);
+    case 1: return n + "." + std::to_string(100 + i * 37 % 900);
+    case 2: return "-" + n + ".0625";
+    default: return n + "." + std::to_string(i % 97) + "e-3";
+    }
+}
+
+// Members with numeric values; quoted holds the same numbers as strings, the
+// way they are sent to a parser without numbers
+inline std::string numeric_object(size_t count, bool quoted) {
+    const char* q = quoted ? "\"" : "";
+    std::string s = "{";
+    for (size_t i = 0; i < count; i++) {
+        s += i ? ",\n  \"" : "\n  \"";
+        s += "sample" + std::to_string(i) + "\" : " + q + numeric_value(i) + q;
+    }
+    return s + "\n}";
+}
+
+// One long array of numbers, or of the same numbers as strings
+inline std::string numeric_series(size_t count, bool quoted) {
+    const char* q = quoted ? "\"" : "";
+    std::string s = "{ \"series\" : [";
+    for (size_t i = 0; i < count; i++) s += (i ? ", " : " ") + (q + numeric_value(i) + q);
+    return s + " ] }";
+}
+
+} // namespace corpora
@@ -0,0 +1,788 @@
+//
+// Benchmarks for Mini Json parser
+//
+// Copyright(c) 2020 Alex Demyankov <alex.demyankov@gmail.com>
+// All rights reserved.
+//
+// Licensed under the MIT license; A copy of the license that can be
+// found in the LICENSE file.
+//
+// Usage: mjson_bench [--quick] [filter]
+//
+
+#include "bench.hpp"
+#include "corpora.hpp"
+
+#include <mjson/mjson.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Counts the heap allocations for the allocs/op column. Every form of new
+// and delete is replaced, so each new is paired with the delete which frees
+// what it allocated.
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+namespace {
+
+void* allocate(size_t size) {
+    bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+// The frees are kept out of line: once inlined into a delete expression,
+// GCC flags a free() or a read before a pointer which came from new
+BENCH_NOINLINE void deallocate(void* p) noexcept { std::free(p); }
+
+// An over-aligned block keeps the pointer to free just before it
+void* allocate(size_t size, std::align_val_t al) {
+    const size_t align = std::max(static_cast<size_t>(al), alignof(std::max_align_t));
+    char* raw = static_cast<char*>(allocate(size + align));
+    if (!raw) return nullptr;
+    char* p = raw + align - reinterpret_cast<uintptr_t>(raw) % align;
+    reinterpret_cast<void**>(p)[-1] = raw;
+    return p;
+}
+
+BENCH_NOINLINE void deallocate(void* p, std::align_val_t) noexcept {
+    if (p) deallocate(static_cast<void**>(p)[-1]);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    if (void* p = allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t al) {
+    if (void* p = allocate(size, al)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new[](size_t size, std::align_val_t al) { return operator new(size, al); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return allocate(size, al); }
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return allocate(size, al); }
+
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t al) noexcept { deallocate(p, al); }
+void operator delete[](void* p, std::align_val_t al) noexcept { deallocate(p, al); }
+void operator delete(void* p, size_t, std::align_val_t al) noexcept { deallocate(p, al); }
+void operator delete[](void* p, size_t, std::align_val_t al) noexcept { deallocate(p, al); }
+void operator delete(void* p, std::align_val_t al, const std::nothrow_t&) noexcept { deallocate(p, al); }
+void operator delete[](void* p, std::align_val_t al, const std::nothrow_t&) noexcept { deallocate(p, al); }
+
+namespace {
+
+struct update_info {
+    std::string_view server;
+    std::string_view connection;
+    std::vector<std::string_view> client_auth;
+};
+
+struct firmware_info {
+    std::string_view version;
+    std::vector<std::string_view> image;
+    update_info update;
+    std::string_view md5;
+};
+
+struct device_info {
+    std::string_view device;
+    std::string_view id;
+    std::string_view type;
+    firmware_info firmware;
+    std::string_view signature;
+};
+
+} // namespace
+
+template <>
+struct mjson::schema<update_info> {
+    static constexpr auto fields = std::make_tuple(
+        field("Server", &update_info::server),
+        field("Connection", &update_info::connection),
+        field("Client.Auth", &update_info::client_auth));
+};
+
+template <>
+struct mjson::schema<firmware_info> {
+    static constexpr auto fields = std::make_tuple(
+        field("Version", &firmware_info::version),
+        field("Image", &firmware_info::image),
+        field("Update", &firmware_info::update),
+        field("MD5", &firmware_info::md5));
+};
+
+template <>
+struct mjson::schema<device_info> {
+    static constexpr auto fields = std::make_tuple(
+        field("Device", &device_info::device),
+        field("ID", &device_info::id),
+        field("Type", &device_info::type),
+        field("Firmware", &device_info::firmware),
+        field("Signature", &device_info::signature));
+};
+
+namespace {
+
+const char* kernel_name(mjson::scan_kernel k) {
+    switch (k) {
+    case mjson::scan_kernel::bytewise: return "bytewise";
+    case mjson::scan_kernel::scalar: return "scalar";
+    case mjson::scan_kernel::sse2: return "sse2";
+    case mjson::scan_kernel::avx2: return "avx2";
+    }
+    return "";
+}
+
+// Scanner kernels against the byte-at-a-time state machine
+void scanner_suite() {
+    bench::header("Scanner kernels");
+
+    const std::string inputs[] = { corpora::long_strings(64, 4096), corpora::long_strings(1024, 16),
+                                   corpora::escaped_strings(64, 4096) };
+    const char* names[] = { "long strings", "short strings", "escaped strings" };
+
+    const auto active = mjson::get_scan_kernel();
+    for (auto k : { mjson::scan_kernel::bytewise, mjson::scan_kernel::scalar,
+                    mjson::scan_kernel::sse2, mjson::scan_kernel::avx2 }) {
+        if (!mjson::set_scan_kernel(k)) continue;
+
+        for (size_t i = 0; i < 3; i++) {
+            const std::string& in = inputs[i];
+            const std::string name = std::string(names[i]) + "/" + kernel_name(k);
+
+            bench::run("json/" + name, in.size(), [&]() {
+                mjson::json js(in);
+                return js.size();
+            });
+            bench::run("json_view/" + name, in.size(), [&]() {
+                mjson::json_view js(in);
+                return js.size();
+            });
+        }
+    }
+    mjson::set_scan_kernel(active);
+}
+
+// The node-based layout the flat member table replaced
+struct map_dom {
+    std::map<std::string, std::string> kvm;
+    std::map<std::string, std::vector<std::string>> kam;
+
+    explicit map_dom(mjson::json& js) {
+        for (size_t i = 0; i < js.size(); i++) {
+            const std::string key(js.key(i));
+            if (js.kind_of(i) == mjson::kind::string) kvm[key] = js.get(i);
+            if (js.kind_of(i) == mjson::kind::array) kam[key] = js.get_array(i);
+        }
+    }
+};
+
+// Member lookup and traversal of the flat table against std::map
+void dom_suite() {
+    bench::header("Members: flat table vs std::map");
+
+    for (size_t count : { 4, 8, 64, 4096 }) {
+        const std::string in = corpora::wide_object(count);
+        mjson::json js(in);
+        map_dom md(js);
+
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < js.size(); i++) keys.emplace_back(js.key(i));
+
+        const std::string n = std::to_string(count);
+
+        bench::run("lookup/flat/" + n + " members", 0, [&]() {
+            size_t sum = 0;
+            for (auto& k : keys) sum += js.get(k).size() + js.get_array(k).size();
+            return sum;
+        });
+        bench::run("lookup/map/" + n + " members", 0, [&]() {
+            size_t sum = 0;
+            for (auto& k : keys) {
+                auto v = md.kvm.find(k);
+                auto a = md.kam.find(k);
+                sum += (v != md.kvm.end() ? v->second.size() : 0) + (a != md.kam.end() ? a->second.size() : 0);
+            }
+            return sum;
+        });
+
+        bench::run("traversal/flat/" + n + " members", 0, [&]() {
+            size_t sum = 0;
+            for (size_t i = 0; i < js.size(); i++)
+                sum += js.kind_of(i) == mjson::kind::string ? js.get(i).size() : js.get_array(i).size();
+            return sum;
+        });
+        bench::run("traversal/map/" + n + " members", 0, [&]() {
+            size_t sum = 0;
+            for (auto& kv : md.kvm) sum += kv.second.size();
+            for (auto& kv : md.kam) sum += kv.second.size();
+            return sum;
+        });
+    }
+}
+
+// Reading two members of a document full of nested objects
+void lazy_suite() {
+    bench::header("Sparse reads: eager vs lazy nested objects");
+
+    const std::string in = corpora::sparse_document(256);
+
+    bench::run("sparse/eager", in.size(), [&]() {
+        mjson::json_view js(in);
+        return js["Device"].size() + js.get_object("object7")["member2"].size();
+    });
+    bench::run("sparse/lazy", in.size(), [&]() {
+        mjson::json_view js(in, mjson::options{ true });
+        return js["Device"].size() + js.get_object("object7")["member2"].size();
+    });
+}
+
+// Fixed layout parsed into a struct against the document parsers
+void schema_suite() {
+    bench::header("Schema parser: hello config");
+
+    const std::string in = corpora::hello_config;
+    std::string copy(in.size(), ' ');
+    device_info d;
+
+    bench::run("schema/memcpy", in.size(), [&]() {
+        std::memcpy(&copy[0], in.data(), in.size());
+        return static_cast<size_t>(copy[in.size() / 2]);
+    });
+    bench::run("schema/parse_into", in.size(), [&]() {
+        mjson::parse_into(in, d);
+        return d.firmware.update.server.size();
+    });
+    bench::run("schema/json_view", in.size(), [&]() {
+        mjson::json_view js(in);
+        return js.get_object("Firmware").get_object("Update")["Server"].size();
+    });
+    bench::run("schema/json", in.size(), [&]() {
+        mjson::json js(in);
+        return js.get_object("Firmware").get_object("Update")["Server"].size();
+    });
+}
+
+// Batch of independent documents on 1 to N threads
+void batch_suite() {
+#ifdef MJSON_PMR
+    bench::header("Batch parsing: hello config x 4096");
+
+    const std::string in = corpora::hello_config;
+    const std::vector<std::string_view> docs(4096, in);
+    const size_t bytes = in.size() * docs.size();
+
+    // The batch keeps all its documents, so does the baseline
+    bench::run("batch/sequential json", bytes, [&]() {
+        std::vector<std::optional<mjson::json>> res(docs.size());
+        for (size_t i = 0; i < docs.size(); i++) res[i].emplace(docs[i]);
+        return res.size();
+    });
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 1; ; t = std::min(t * 2, cores)) {
+        bench::run("batch/parse_batch/" + std::to_string(t) + " threads", bytes, [&]() {
+            return mjson::parse_batch(docs, t).size();
+        });
+        if (t == cores) break;
+    }
+#endif
+}
+
+// One large document on 1 to N threads against the parse on one thread
+void parallel_suite() {
+    bench::header("Parallel parsing: sparse document, 8192 objects");
+
+    const std::string in = corpora::sparse_document(8192);
+
+    bench::run("parallel/json", in.size(), [&]() {
+        mjson::json js(in);
+        return js.size();
+    });
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 1; ; t = std::min(t * 2, cores)) {
+        bench::run("parallel/parse_parallel/" + std::to_string(t) + " threads", in.size(), [&]() {
+            return mjson::parse_parallel(in, t).size();
+        });
+        bench::run("parallel/parse_parallel view/" + std::to_string(t) + " threads", in.size(), [&]() {
+            return mjson::parse_parallel<mjson::json_view>(in, t).size();
+        });
+        if (t == cores) break;
+    }
+}
+
+// Newline-delimited records read one by one against a json per line
+void ndjson_suite() {
+    bench::header("NDJSON: 4096 records");
+
+    std::string log;
+    for (size_t i = 0; i < 4096; i++) {
+        const std::string n = std::to_string(i);
+        log += R"({ "id" : ")" + n + R"(", "level" : "info", "tags" : [ "a", "b" ], "ctx" : { "host" : "node)" + n + R"(" } })" "\n";
+    }
+
+    bench::run("ndjson/json per line", log.size(), [&]() {
+        size_t sum = 0;
+        for (size_t b = 0, e; (e = log.find('\n', b)) != std::string::npos; b = e + 1)
+            sum += mjson::json(std::string_view(log).substr(b, e - b)).size();
+        return sum;
+    });
+    bench::run("ndjson/document_stream", log.size(), [&]() {
+        size_t sum = 0;
+        mjson::document_stream ds(log);
+        for (auto& js : ds) sum += js.size();
+        return sum;
+    });
+    bench::run("ndjson/document_view_stream", log.size(), [&]() {
+        size_t sum = 0;
+        mjson::document_view_stream ds(log);
+        for (auto& js : ds) sum += js.size();
+        return sum;
+    });
+#ifdef MJSON_PMR
+    bench::run("ndjson/split_documents + parse_batch", log.size(), [&]() {
+        return mjson::parse_batch(mjson::split_documents(log)).size();
+    });
+#endif
+}
+
+// Validation only against the parse which builds the document
+void validate_suite() {
+    bench::header("Validation");
+
+    const std::pair<const char*, std::string> inputs[] = {
+        { "hello config", corpora::hello_config },
+        { "flat wide object", corpora::wide_object(4096) },
+        { "deeply nested", corpora::deep_object(256) },
+        { "long strings", corpora::long_strings(64, 4096) },
+        { "escaped strings", corpora::escaped_strings(64, 4096) },
+        { "short arrays", corpora::short_arrays(2048) },
+        { "numeric object", corpora::numeric_object(2048, false) },
+    };
+
+    for (auto& in : inputs) {
+        const std::string name = in.first;
+        bench::run("validate/json/" + name, in.second.size(), [&]() {
+            return mjson::json(in.second).is_valid();
+        });
+        bench::run("validate/json_view/" + name, in.second.size(), [&]() {
+            return mjson::json_view(in.second).is_valid();
+        });
+        bench::run("validate/validate/" + name, in.second.size(), [&]() {
+            return mjson::validate(in.second).valid;
+        });
+    }
+}
+
+// Parse throughput and member lookup latency on the generated corpora
+void corpora_suite() {
+    bench::header("Corpora");
+
+    struct corpus {
+        const char* name;
+        std::string text;
+        std::vector<std::string> path;  // objects to descend into, then a value
+    };
+
+    const corpus inputs[] = {
+        { "hello config", corpora::hello_config, { "Firmware", "Update", "Server" } },
+        { "flat wide object", corpora::wide_object(4096), { "member4094" } },
+        { "deeply nested", corpora::deep_object(256), { "child", "child", "child", "name" } },
+        { "long strings", corpora::long_strings(64, 4096), { "key63" } },
+        { "short arrays", corpora::short_arrays(2048), { "list2047" } },
+    };
+
+    for (auto& c : inputs) {
+        const std::string name = c.name;
+        const std::string& in = c.text;
+        const bool rss = bench::reset_peak_rss();
+        const size_t rss_start = bench::recent_peak_rss_kb();
+
+        bench::run("parse/json/" + name, in.size(), [&]() {
+            mjson::json js(in);
+            return js.size();
+        });
+        bench::run("parse/json_view/" + name, in.size(), [&]() {
+            mjson::json_view js(in);
+            return js.size();
+        });
+
+        mjson::json js(in);
+        bench::run("lookup/" + name, 0, [&]() {
+            mjson::json* obj = &js;
+            for (size_t i = 0; i + 1 < c.path.size(); i++) obj = &obj->get_object(c.path[i]);
+            auto& key = c.path.back();
+            return obj->get(key).size() + obj->get_array(key).size();
+        });
+
+        // The peak of the process while this corpus was parsed and read, and
+        // its growth over the resident size the corpus started from
+        if (rss) {
+            const size_t peak = bench::recent_peak_rss_kb();
+            std::printf("%-48s peak RSS %zu KB (+%zu KB)\n", ("memory/" + name).c_str(), peak,
+                        peak - std::min(peak, rss_start));
+        }
+    }
+}
+
+// Native numbers against numbers sent as strings and converted by std::stod
+void numbers_suite() {
+    bench::header("Numbers");
+
+    const size_t members = 2048, items = 16384;
+    const std::string object = corpora::numeric_object(members, false);
+    const std::string object_quoted = corpora::numeric_object(members, true);
+    const std::string series = corpora::numeric_series(items, false);
+    const std::string series_quoted = corpora::numeric_series(items, true);
+
+    bench::run("numbers/strings + std::stod/object", object_quoted.size(), [&]() {
+        mjson::json js(object_quoted);
+        double sum = 0;
+        for (size_t i = 0; i < js.size(); i++) sum += std::stod(js.get(i));
+        return static_cast<size_t>(sum);
+    });
+    bench::run("numbers/json/object", object.size(), [&]() {
+        mjson::json js(object);
+        double sum = 0;
+        for (size_t i = 0; i < js.size(); i++) sum += js.get_number(i).as_double();
+        return static_cast<size_t>(sum);
+    });
+    bench::run("numbers/json_view/object", object.size(), [&]() {
+        mjson::json_view js(object);
+        double sum = 0;
+        for (size_t i = 0; i < js.size(); i++) sum += js.get_number(i).as_double();
+        return static_cast<size_t>(sum);
+    });
+
+    bench::run("numbers/strings + std::stod/series", series_quoted.size(), [&]() {
+        mjson::json_view js(series_quoted);
+        double sum = 0;
+        for (auto& v : js.get_array("series")) sum += std::stod(std::string(v));
+        return static_cast<size_t>(sum);
+    });
+    bench::run("numbers/json_view/series", series.size(), [&]() {
+        mjson::json_view js(series);
+        auto& list = js.get_list("series");
+        double sum = 0;
+        for (size_t i = 0; i < list.size(); i++) sum += list.get_number(i).as_double();
+        return static_cast<size_t>(sum);
+    });
+
+    bench::run("numbers/sax/series", series.size(), [&]() {
+        struct adder : mjson::sax_handler {
+            double sum = 0;
+            bool on_number(mjson::number n) { sum += n.as_double(); return true; }
+        } h;
+        mjson::sax_parse(series, h);
+        return static_cast<size_t>(h.sum);
+    });
+}
+
+// Serialization of parsed documents
+void writer_suite() {
+    bench::header("Writer");
+
+    const std::pair<const char*, std::string> inputs[] = {
+        { "hello config", corpora::hello_config },
+        { "flat wide object", corpora::wide_object(4096) },
+        { "long strings", corpora::long_strings(64, 4096) },
+        { "numeric object", corpora::numeric_object(2048, false) },
+    };
+
+    for (auto& in : inputs) {
+        mjson::json js(in.second);
+        const std::string name = in.first;
+        const size_t bytes = mjson::writer::measure(js);
+
+        bench::run("write/compact/" + name, bytes, [&]() { return mjson::to_string(js).size(); });
+        bench::run("write/pretty/" + name, bytes, [&]() {
+            return mjson::to_string(js, mjson::writer::pretty).size();
+        });
+    }
+}
+
+// Many small messages through one parser against a document per message
+void parser_suite() {
+    bench::header("Reusable parser: hello config");
+
+    const std::string in = corpora::hello_config;
+
+    bench::run("reuse/json per message", in.size(), [&]() {
+        mjson::json js(in);
+        return js.size();
+    });
+
+    mjson::parser p;
+    mjson::json js;
+    bench::run("reuse/parser", in.size(), [&]() {
+        p.parse(in, js);
+        return js.size();
+    });
+
+    mjson::view_parser vp;
+    mjson::json_view view;
+    bench::run("reuse/view_parser", in.size(), [&]() {
+        vp.parse(in, view);
+        return view.size();
+    });
+}
+
+// Documents of one kind parsed with a shared key table, and lookups by the
+// interned keys against the lookups by strings
+void keys_suite() {
+    bench::header("Key table");
+
+    mjson::key_table table;
+    const mjson::options opt{ false, mjson::default_max_depth, &table };
+    const std::string hello = corpora::hello_config;
+
+    mjson::parser p;
+    mjson::parser interning(opt);
+    mjson::json js;
+    bench::run("keys/parser/hello config", hello.size(), [&]() {
+        p.parse(hello, js);
+        return js.size();
+    });
+    bench::run("keys/parser + key table/hello config", hello.size(), [&]() {
+        interning.parse(hello, js);
+        return js.size();
+    });
+
+    for (size_t count : { 8, 4096 }) {
+        const std::string in = corpora::wide_object(count);
+        mjson::json plain(in);
+        mjson::json shared(in, opt);
+
+        std::vector<std::string> names;
+        std::vector<mjson::key_ref> keys;
+        for (size_t i = 0; i < plain.size(); i++) {
+            names.emplace_back(plain.key(i));
+            keys.push_back(table.intern(plain.key(i)));
+        }
+
+        const std::string n = std::to_string(count);
+        bench::run("keys/lookup by string/" + n + " members", 0, [&]() {
+            size_t sum = 0;
+            for (auto& k : names) sum += plain.has(k);
+            return sum;
+        });
+        bench::run("keys/lookup by interned key/" + n + " members", 0, [&]() {
+            size_t sum = 0;
+            for (auto& k : keys) sum += shared.has(k);
+            return sum;
+        });
+    }
+}
+
+// Lookups in a shared config while other threads read it too: a snapshot
+// reader against a mutex and an atomic load of the current version
+void snapshot_suite() {
+    bench::header("Config snapshot: 1 + 3 reading threads");
+
+    mjson::config_snapshot cfg(corpora::hello_config);
+    std::mutex m;
+    std::shared_ptr<const mjson::json> locked = cfg.load();
+
+    // make() gives the lookup of one thread
+    const auto contended = [&](const char* name, auto make) {
+        std::atomic<bool> done{ false };
+        std::vector<std::thread> others;
+        for (int t = 0; t < 3; t++) {
+            others.emplace_back([&]() {
+                auto lookup = make();
+                while (!done) bench::sink += lookup();
+            });
+        }
+
+        bench::run(name, 0, make());
+        done = true;
+        for (auto& t : others) t.join();
+    };
+
+    contended("snapshot/mutex", [&]() {
+        return [&]() {
+            std::lock_guard<std::mutex> lock(m);
+            return locked->get("Device").size();
+        };
+    });
+    contended("snapshot/atomic load", [&]() {
+        return [&]() { return cfg.load()->get("Device").size(); };
+    });
+    contended("snapshot/reader", [&]() {
+        return [r = mjson::config_snapshot::reader(cfg)]() mutable { return r->get("Device").size(); };
+    });
+}
+
+// Cold start with one lookup: parsing the text against loading the binary
+// form, from memory and from a file mapped for every operation. A load reads
+// only the bytes the lookup touches, so its rows have no throughput.
+void binary_suite() {
+    bench::header("Binary form");
+
+    const std::pair<const char*, std::string> inputs[] = {
+        { "hello config", corpora::hello_config },
+        { "flat wide object", corpora::wide_object(4096) },
+    };
+
+    for (auto& in : inputs) {
+        const std::string name = in.first;
+        mjson::json js(in.second);
+        const std::string data = mjson::save_binary(js);
+        const std::string key(js.key(js.size() / 2));
+
+        const std::string text_path = "mjson_bench.json";
+        const std::string binary_path = "mjson_bench.mjsb";
+        { std::ofstream(text_path, std::ios::binary) << in.second; }
+        { std::ofstream(binary_path, std::ios::binary) << data; }
+
+        bench::run("binary/parse/" + name, in.second.size(), [&]() {
+            mjson::json doc(in.second);
+            return doc.has(key);
+        });
+        bench::run("binary/load/" + name, 0, [&]() {
+            return mjson::load_binary(data).has(key);
+        });
+        bench::run("binary/parse file/" + name, in.second.size(), [&]() {
+            return mjson::json_view::from_file(text_path).has(key);
+        });
+        bench::run("binary/load file/" + name, 0, [&]() {
+            return mjson::binary_view::from_file(binary_path).has(key);
+        });
+
+        std::remove(text_path.c_str());
+        std::remove(binary_path.c_str());
+    }
+}
+
+// Counts the members of every object without building a tree
+struct counter : mjson::sax_handler {
+    size_t keys = 0;
+    bool on_key(std::string_view) { ++keys; return true; }
+};
+
+// Finds the Version member and stops
+struct finder : mjson::sax_handler {
+    bool next = false;
+    std::string_view found;
+
+    bool on_key(std::string_view key) { next = key == "Version"; return true; }
+    bool on_string(std::string_view value) {
+        if (next) found = value;
+        return !next;
+    }
+};
+
+// Filtering without a tree against json_view
+void sax_suite() {
+    bench::header("SAX interface");
+
+    const std::pair<const char*, std::string> inputs[] = {
+        { "hello config", corpora::hello_config },
+        { "flat wide object", corpora::wide_object(4096) },
+    };
+
+    for (auto& in : inputs) {
+        const std::string name = in.first;
+
+        bench::run("sax/count keys/" + name, in.second.size(), [&]() {
+            counter c;
+            mjson::sax_parse(in.second, c);
+            return c.keys;
+        });
+        bench::run("sax/json_view/" + name, in.second.size(), [&]() {
+            mjson::json_view js(in.second);
+            return js.size();
+        });
+    }
+
+    const std::string in = corpora::hello_config;
+    bench::run("sax/stop at Version/hello config", 0, [&]() {
+        finder f;
+        mjson::sax_parse(in, f);
+        return f.found.size();
+    });
+}
+
+// One value out of a document against a tree and get_object() chains
+void extract_suite() {
+    bench::header("Path extraction");
+
+    const std::string hello = corpora::hello_config;
+    bench::run("extract/hello config", hello.size(), [&]() {
+        return mjson::extract(hello, { "Firmware", "Update", "Server" })->size();
+    });
+    bench::run("extract/json_view tree/hello config", hello.size(), [&]() {
+        mjson::json_view js(hello);
+        return js.get_object("Firmware").get_object("Update")["Server"].size();
+    });
+
+    const std::string sparse = corpora::sparse_document(256);
+    bench::run("extract/sparse document", sparse.size(), [&]() {
+        return mjson::extract(sparse, { "object200", "member10" })->size();
+    });
+    bench::run("extract/json_view tree/sparse document", sparse.size(), [&]() {
+        mjson::json_view js(sparse);
+        return js.get_object("object200")["member10"].size();
+    });
+    bench::run("extract_all/3 paths/sparse document", sparse.size(), [&]() {
+        auto v = mjson::extract_all(sparse, { { "Device" }, { "object7", "member1" }, { "object200", "member10" } });
+        return v[2]->size();
+    });
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--quick")) bench::min_time = 0.01;
+        else bench::filter = argv[i];
+    }
+
+    corpora_suite();
+    scanner_suite();
+    validate_suite();
+    dom_suite();
+    lazy_suite();
+    schema_suite();
+    batch_suite();
+    parallel_suite();
+    ndjson_suite();
+    numbers_suite();
+    writer_suite();
+    parser_suite();
+    keys_suite();
+    snapshot_suite();
+    binary_suite();
+    sax_suite();
+    extract_suite();
+
+    if (size_t rss = bench::peak_rss_kb()) std::printf("\npeak RSS of the whole process: %zu KB\n", rss);
+    return 0;
+}
@@ -11,7 +11,8 @@
 //
 // Supported values:
 //    - "string"
-//    - [array of "strings"] (no nested arrays)
+//    - numbers, true, false and null
+//    - [array of any values]
 //    - {object}
 //
 // Lang: C++17 (can be easily converted to C++14 by refactoring static inline initialization)
@@ -23,21 +24,700 @@
 //
 
 #include <iostream>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <array>
-#include <map>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <cstdint>
+#include <tuple>
+#include <cstring>
+#include <iterator>
+#include <utility>
+#include <atomic>
+#include <optional>
+#include <initializer_list>
+#include <thread>
+#include <charconv>
+#include <limits>
+#include <forward_list>
+#include <shared_mutex>
+#include <mutex>
+
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define MJSON_PMR
+#endif
+
+// std::from_chars and std::to_chars of doubles came with gcc 11 and MSVC
+// 2019; with an older library doubles go through strtod() and snprintf()
+#if defined(__cpp_lib_to_chars) && !defined(MJSON_NO_FLOAT_CHARCONV)
+#define MJSON_FLOAT_CHARCONV
+#else
+#include <cerrno>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MJSON_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Parse statistics are only collected when MJSON_STATS is defined
+#ifdef MJSON_STATS
+#include <chrono>
+#define MJSON_STAT(x) x
+#else
+#define MJSON_STAT(x)
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MJSON_TARGET(arch) __attribute__((target(arch)))
+#else
+#define MJSON_TARGET(arch)
+#endif
 
 namespace mjson {
 
-class json {
+//
+// Scanner kernels used by the parser to skip string bodies and whitespace in
+// bulk, so the state machine only runs on the bytes which change its state.
+// The fastest kernel supported by the CPU is selected at runtime; bytewise
+// disables the skipping and feeds every byte to the state machine.
+//
+enum class scan_kernel { bytewise, scalar, sse2, avx2 };
+
+namespace detail {
+
+// Scanners return the position of the first byte which is not a part of the
+// run, or 'e' if the run reaches the end of the input
+using scan_fn = const char* (*)(const char* p, const char* e);
+
+struct scanner {
+    scan_kernel kernel;
+    scan_fn string_end;     // the closing quote, a backslash or a control char in a string
+    scan_fn whitespace_end; // the first non-whitespace char
+};
+
+inline bool is_string_end(char c) {
+    return c == '"' || c == '\\' || c == '\t' || c == '\n' || c == '\r';
+}
+inline bool is_whitespace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+inline const char* scalar_string_end(const char* p, const char* e) {
+    while (p < e && !is_string_end(*p)) ++p;
+    return p;
+}
+
+inline const char* scalar_whitespace_end(const char* p, const char* e) {
+    while (p < e && is_whitespace(*p)) ++p;
+    return p;
+}
+
+#ifdef MJSON_X86
+inline unsigned ctz(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return i;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+MJSON_TARGET("sse2") inline const char* sse2_string_end(const char* p, const char* e) {
+    const __m128i q = _mm_set1_epi8('"'), s = _mm_set1_epi8('\\'), t = _mm_set1_epi8('\t');
+    const __m128i n = _mm_set1_epi8('\n'), r = _mm_set1_epi8('\r');
+
+    for (; e - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, q), _mm_cmpeq_epi8(v, t)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, n), _mm_cmpeq_epi8(v, r)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, s));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(m));
+        if (mask) return p + ctz(mask);
+    }
+
+    return scalar_string_end(p, e);
+}
+
+MJSON_TARGET("sse2") inline const char* sse2_whitespace_end(const char* p, const char* e) {
+    const __m128i s = _mm_set1_epi8(' '), t = _mm_set1_epi8('\t');
+    const __m128i n = _mm_set1_epi8('\n'), r = _mm_set1_epi8('\r');
+
+    for (; e - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, s), _mm_cmpeq_epi8(v, t)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, n), _mm_cmpeq_epi8(v, r)));
+        uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_epi8(m)) & 0xffff;
+        if (mask) return p + ctz(mask);
+    }
+
+    return scalar_whitespace_end(p, e);
+}
+
+MJSON_TARGET("avx2") inline const char* avx2_string_end(const char* p, const char* e) {
+    const __m256i q = _mm256_set1_epi8('"'), s = _mm256_set1_epi8('\\'), t = _mm256_set1_epi8('\t');
+    const __m256i n = _mm256_set1_epi8('\n'), r = _mm256_set1_epi8('\r');
+
+    for (; e - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, q), _mm256_cmpeq_epi8(v, t)),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(v, n), _mm256_cmpeq_epi8(v, r)));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, s));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(m));
+        if (mask) return p + ctz(mask);
+    }
+
+    return sse2_string_end(p, e);
+}
+
+MJSON_TARGET("avx2") inline const char* avx2_whitespace_end(const char* p, const char* e) {
+    const __m256i s = _mm256_set1_epi8(' '), t = _mm256_set1_epi8('\t');
+    const __m256i n = _mm256_set1_epi8('\n'), r = _mm256_set1_epi8('\r');
+
+    for (; e - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, s), _mm256_cmpeq_epi8(v, t)),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(v, n), _mm256_cmpeq_epi8(v, r)));
+        uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(m));
+        if (mask) return p + ctz(mask);
+    }
+
+    return sse2_whitespace_end(p, e);
+}
+
+inline bool cpu_has(scan_kernel k) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    if (k != scan_kernel::avx2) return true;
+
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    // AVX registers have to be enabled by the OS as well
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    if (k == scan_kernel::avx2) return __builtin_cpu_supports("avx2");
+    if (k == scan_kernel::sse2) return __builtin_cpu_supports("sse2");
+    return true;
+#endif
+}
+#else
+inline bool cpu_has(scan_kernel k) { return k == scan_kernel::bytewise || k == scan_kernel::scalar; }
+#endif
+
+inline scanner make_scanner(scan_kernel k) {
+    switch (k) {
+#ifdef MJSON_X86
+    case scan_kernel::avx2: return { k, avx2_string_end, avx2_whitespace_end };
+    case scan_kernel::sse2: return { k, sse2_string_end, sse2_whitespace_end };
+#endif
+    default: return { k, scalar_string_end, scalar_whitespace_end };
+    }
+}
+
+inline scanner& active_scanner() {
+    static scanner sc = make_scanner(cpu_has(scan_kernel::avx2) ? scan_kernel::avx2 :
+                                     cpu_has(scan_kernel::sse2) ? scan_kernel::sse2 : scan_kernel::scalar);
+    return sc;
+}
+
+} // namespace detail
+
+// Selects the scanner kernel for the following parses; returns false if the
+// CPU does not support it. Meant for tests and benchmarks: it is not safe to
+// switch kernels while other threads are parsing.
+inline bool set_scan_kernel(scan_kernel k) {
+    if (!detail::cpu_has(k)) return false;
+    detail::active_scanner() = detail::make_scanner(k);
+    return true;
+}
+
+inline scan_kernel get_scan_kernel() { return detail::active_scanner().kernel; }
+
+// Deeper documents are rejected unless the options allow them; this bounds
+// the memory and the stack used by untrusted input
+inline constexpr size_t default_max_depth = 1024;
+
+//
+// A number value. Integers which fit into int64_t are kept exact, the other
+// numbers as double.
+//
+class number {
+public:
+    number() = default;
+    explicit number(int64_t i) : i_(i) {}
+    explicit number(double d) : d_(d), integer_(false) {}
+
+    bool is_integer() const { return integer_; }
+
+    // A double is truncated towards zero
+    int64_t as_int() const { return integer_ ? i_ : static_cast<int64_t>(d_); }
+    double as_double() const { return integer_ ? static_cast<double>(i_) : d_; }
+
+    bool operator==(const number& n) const {
+        return integer_ == n.integer_ && (integer_ ? i_ == n.i_ : d_ == n.d_);
+    }
+    bool operator!=(const number& n) const { return !(*this == n); }
+
+private:
+    int64_t i_{};
+    double d_{};
+    bool integer_{ true };
+};
+
+namespace detail {
+
+inline bool is_digit(char c) { return static_cast<unsigned>(c - '0') < 10u; }
+
+#ifdef MJSON_FLOAT_CHARCONV
+// The whole of [b, e) is one number in the json syntax
+inline std::errc read_double(const char* b, const char* e, double& d) {
+    const auto res = std::from_chars(b, e, d);
+    return res.ec == std::errc() && res.ptr != e ? std::errc::invalid_argument : res.ec;
+}
+
+// The shortest text which reads back as 'd', into at least 32 chars
+inline char* write_double(char* buf, double d) { return std::to_chars(buf, buf + 32, d).ptr; }
+#else
+// strtod() and snprintf() use the decimal point of the C locale
+inline char decimal_point() { return *std::localeconv()->decimal_point; }
+
+inline std::errc read_double(const char* b, const char* e, double& d) {
+    char small[64];
+    std::string large;
+    char* s = small;
+    if (static_cast<size_t>(e - b) >= sizeof(small)) {
+        large.resize(e - b + 1);
+        s = &large[0];
+    }
+    std::memcpy(s, b, e - b);
+    s[e - b] = 0;
+    if (char* dot = static_cast<char*>(std::memchr(s, '.', e - b))) *dot = decimal_point();
+
+    char* end = nullptr;
+    errno = 0;
+    d = std::strtod(s, &end);
+    if (end != s + (e - b)) return std::errc::invalid_argument;
+    return errno == ERANGE && (d == 0 || d - d != 0) ? std::errc::result_out_of_range : std::errc();
+}
+
+// The fewest digits, from 15 to 17, which read back as 'd'
+inline char* write_double(char* buf, double d) {
+    int n = 0;
+    for (int digits = 15; digits <= 17; digits++) {
+        n = std::snprintf(buf, 32, "%.*g", digits, d);
+        if (std::strtod(buf, nullptr) == d) break;
+    }
+    if (char* dot = static_cast<char*>(std::memchr(buf, decimal_point(), n))) *dot = '.';
+    return buf + n;
+}
+#endif
+
+//
+// Parses a json number. The digits are accumulated in one pass, which gives
+// integers directly; a double with up to 15 significant digits and a small
+// exponent is one exact multiplication or division of the digits by a power
+// of ten, so it is rounded correctly. Only the other doubles go through
+// read_double().
+//
+inline bool parse_number(std::string_view t, number& n) {
+    const char* p = t.data();
+    const char* const e = p + t.size();
+
+    const bool neg = p < e && *p == '-';
+    if (neg) ++p;
+    if (p == e) return false;
+
+    uint64_t m = 0;
+    size_t digits = 0;
+    if (*p == '0') {
+        ++p;
+    } else {
+        const char* const b = p;
+        for (; p < e && is_digit(*p); ++p) m = m * 10 + static_cast<unsigned>(*p - '0');
+        if (p == b) return false;
+        digits = p - b;
+    }
+
+    int frac = 0;
+    if (p < e && *p == '.') {
+        const char* const b = ++p;
+        for (; p < e && is_digit(*p); ++p) {
+            m = m * 10 + static_cast<unsigned>(*p - '0');
+            if (m) ++digits;
+        }
+        if (p == b) return false;
+        frac = static_cast<int>(p - b);
+    }
+
+    int exp = 0;
+    const bool real = frac || (p < e && (*p == 'e' || *p == 'E'));
+    if (p < e && (*p == 'e' || *p == 'E')) {
+        bool exp_neg = false;
+        if (++p < e && (*p == '+' || *p == '-')) exp_neg = *p++ == '-';
+
+        const char* const b = p;
+        for (; p < e && is_digit(*p); ++p)
+            if (exp < 100000) exp = exp * 10 + (*p - '0');
+        if (p == b) return false;
+        if (exp_neg) exp = -exp;
+    }
+    if (p != e) return false;
+
+    if (!real && digits <= 19) {
+        constexpr uint64_t max = static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+        if (m <= max) {
+            n = number(neg ? -static_cast<int64_t>(m) : static_cast<int64_t>(m));
+            return true;
+        }
+        if (neg && m == max + 1) {
+            n = number(std::numeric_limits<int64_t>::min());
+            return true;
+        }
+    }
+
+    static constexpr double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const int e10 = exp - frac;
+    if (digits <= 15 && e10 >= -22 && e10 <= 22) {
+        double d = static_cast<double>(m);
+        d = e10 < 0 ? d / pow10[-e10] : d * pow10[e10];
+        n = number(neg ? -d : d);
+        return true;
+    }
+
+    double d = 0;
+    const std::errc ec = read_double(t.data(), e, d);
+    if (ec == std::errc::result_out_of_range) {
+        // Out of the range of double: an infinity or a zero
+        d = exp > 0 ? std::numeric_limits<double>::infinity() : 0.0;
+        if (neg) d = -d;
+    } else if (ec != std::errc()) {
+        return false;
+    }
+
+    n = number(d);
+    return true;
+}
+
+inline bool read_hex4(const char* p, const char* e, uint32_t& cp) {
+    if (e - p < 4) return false;
+
+    cp = 0;
+    for (const char* q = p; q < p + 4; ++q) {
+        const char c = *q;
+        const uint32_t d = is_digit(c) ? c - '0' :
+                           c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                           c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+        if (d == 16) return false;
+        cp = cp * 16 + d;
+    }
+    return true;
+}
+
+template <class Out>
+void append_utf8(uint32_t cp, Out& out) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xc0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xe0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+}
+
+//
+// Decodes the escapes of a string body into 'out'; the runs between them are
+// copied in bulk. A \u escape is written as UTF-8 and a surrogate pair as one
+// code point. An unknown escape or a lone surrogate is an error. The output is
+// a std::string or anything with its clear(), append() and += of a char.
+//
+template <class Out>
+bool unescape(std::string_view s, Out& out) {
+    out.clear();
+
+    const char* p = s.data();
+    const char* const e = p + s.size();
+    while (p < e) {
+        const char* q = static_cast<const char*>(std::memchr(p, '\\', e - p));
+        if (!q) q = e;
+        out.append(p, q - p);
+        if (q == e) break;
+        if (++q == e) return false;
+
+        p = q + 1;
+        switch (*q) {
+        case '"':
+        case '\\':
+        case '/': out += *q; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            uint32_t cp;
+            if (!read_hex4(p, e, cp)) return false;
+            p += 4;
+
+            if (cp >= 0xdc00 && cp <= 0xdfff) return false;
+            if (cp >= 0xd800 && cp <= 0xdbff) {
+                uint32_t low;
+                if (e - p < 6 || p[0] != '\\' || p[1] != 'u' || !read_hex4(p + 2, e, low)) return false;
+                if (low < 0xdc00 || low > 0xdfff) return false;
+                p += 6;
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+            }
+            append_utf8(cp, out);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Output of unescape() which only checks the escapes
+struct null_text {
+    void clear() {}
+    void append(const char*, size_t) {}
+    void operator+=(char) {}
+};
+
+} // namespace detail
+
+// Decodes the escapes of a raw string, e.g. a value found by extract();
+// returns nothing if an escape is not valid
+inline std::optional<std::string> unescape(std::string_view raw) {
+    std::string out;
+    if (!detail::unescape(raw, out)) return std::nullopt;
+    return out;
+}
+
+#ifdef MJSON_STATS
+//
+// Counters of a single parse. Allocations of the document are estimated from
+// the growth of its containers and strings, whatever the allocator is.
+//
+struct parse_stats {
+    enum action {
+        object_begin, object_end, object_skipped, key_start, key_end,
+        value_start, value_end, array_begin, array_end, number, literal,
+        escaped,        // keys and strings decoded because of their escapes
+        actions_count
+    };
+
+    size_t bytes_scanned = 0;   // including the runs skipped by the scanner
+    size_t transitions = 0;     // lookups in the transition matrix
+    std::array<size_t, actions_count> actions{};
+    size_t allocations = 0;
+    size_t bytes_allocated = 0;
+    size_t max_depth = 0;
+    std::chrono::nanoseconds time{};    // spent in the state machine
+};
+
+// Called after every document is parsed, e.g. to log the slow ones
+using stats_callback = void (*)(const parse_stats& stats, std::string_view input);
+
+namespace detail {
+inline stats_callback& stats_handler() {
+    static stats_callback cb{};
+    return cb;
+}
+} // namespace detail
+
+inline void set_stats_callback(stats_callback cb) { detail::stats_handler() = cb; }
+#endif
+
+namespace detail {
+
+inline unsigned char uchar(char c) { return static_cast<unsigned char>(c); }
+
+// Finds the closing brace of the object which starts at 'p' by matching
+// braces; strings are jumped over with the string scanner, along with the
+// chars escaped in them. Returns 'e' if the object does not end before it and
+// nullptr if a string has a control char.
+inline const char* match_braces(const char* p, const char* e) {
+    const scan_fn string_end = active_scanner().string_end;
+
+    size_t depth = 0;
+    for (; p < e; ++p) {
+        switch (*p) {
+        case '"':
+            do p = string_end(p + 1, e);
+            while (p != e && *p == '\\' && ++p != e);
+            if (p == e) return e;
+            if (*p != '"') return nullptr;
+            break;
+        case '{':
+            ++depth;
+            break;
+        case '}':
+            if (!--depth) return p;
+            break;
+        }
+    }
+
+    return e;
+}
+
+//
+// Kinds of the open objects and arrays, a bit per level which is set for an
+// array. The first levels are kept inline, so a usual document does not
+// allocate for them.
+//
+class nesting {
+public:
+    size_t size() const { return size_; }
+    bool in_array() const { return size_ && bit(size_ - 1); }
+
+    void push(bool array) {
+        const size_t w = size_ / 64;
+        if (w >= inline_.size() && w - inline_.size() >= more_.size()) more_.push_back(0);
+
+        uint64_t& word = w < inline_.size() ? inline_[w] : more_[w - inline_.size()];
+        const uint64_t mask = uint64_t(1) << (size_ % 64);
+        word = array ? word | mask : word & ~mask;
+        ++size_;
+    }
+
+    void pop() { --size_; }
+    void clear() { size_ = 0; }
+
+private:
+    bool bit(size_t i) const {
+        const size_t w = i / 64;
+        const uint64_t word = w < inline_.size() ? inline_[w] : more_[w - inline_.size()];
+        return (word >> (i % 64)) & 1;
+    }
+
+    std::array<uint64_t, 4> inline_{};
+    std::vector<uint64_t> more_{};
+    size_t size_{};
+};
+
+// A handler which may skip nested objects
+template <class Handler, class = void>
+struct can_skip : std::false_type {};
+
+template <class Handler>
+struct can_skip<Handler, std::void_t<decltype(std::declval<Handler&>().skip_object())>>
+    : std::true_type {};
+
+// A handler which takes the strings as they are in the input; their escapes
+// are checked but not decoded
+template <class Handler, class = void>
+struct raw_strings : std::false_type {};
+
+template <class Handler>
+struct raw_strings<Handler, std::void_t<decltype(Handler::raw_strings)>>
+    : std::bool_constant<Handler::raw_strings> {};
+
+//
+// The parser finite state machine. The input may be fed in any number of
+// chunks: the state, the nesting and a token split between chunks are kept
+// until the next one arrives. Parsed tokens are passed to the Handler:
+//
+//    bool on_object_begin();
+//    bool on_object_end();
+//    bool on_key(std::string_view key, std::string_view raw);
+//    bool on_string(std::string_view value, std::string_view raw);   // a value or an array item
+//    bool on_number(number value);
+//    bool on_bool(bool value);
+//    bool on_null();
+//    bool on_array_begin();
+//    bool on_array_end();
+//
+// Keys and strings are passed decoded along with their raw text, which are
+// the same slice of the input unless the string has escapes. Only then the
+// string is decoded into a buffer, which is valid until the next event.
+//
+// A handler returns false to reject the document. A handler which has
+//
+//    bool skip_object();
+//    bool on_object_skipped(std::string_view raw);
+//
+// is asked before each nested object whether it is interested in it. A
+// skipped object is only matched by its braces and passed as raw text. A
+// handler with a static raw_strings member set gets the keys and strings
+// with their escapes as they are in the input.
+//
+template <class Handler>
+class fsm {
 public:
-    json(const std::string& s) : s_(s), pos_(0), state_(0) {
-        if (s_.empty()) return;
+    explicit fsm(Handler& h) : h_(h) {}
+
+    // Consumes the chunk up to the end of the document or the first error;
+    // returns the number of bytes consumed. Nothing is kept from the last
+    // chunk for the next one.
+    size_t feed(std::string_view s, bool last = false) {
+        if (state_ < 0) return 0;
+        MJSON_STAT(const auto started = std::chrono::steady_clock::now());
+
+        s_ = s;
+        pos_ = 0;
+        b_ = 0;
+
+        const scanner sc = active_scanner();
+        const bool skip = sc.kernel != scan_kernel::bytewise;
+        const char* const b = s_.data();
+        const char* const e = b + s_.length();
+
+        while (pos_ < s_.length()) {
+            // String bodies and whitespace do not change the state, so
+            // they are skipped in bulk up to the next significant char
+            if (skip) {
+                if (state_ == 2 || state_ == 5)
+                    pos_ = sc.string_end(b + pos_, e) - b;
+                else if (dictionary_[uchar(s_[pos_])] - 1u < 4u && state_ < 9)
+                    pos_ = sc.whitespace_end(b + pos_, e) - b;
+
+                if (pos_ == s_.length()) break;
+            }
 
-        do {
             // Transition matrix gives the next state depending on
             // the current state and the current character
-            char move = transition_[state_][dictionary_[s_.at(pos_)]];
+            MJSON_STAT(++stats_.transitions);
+            char move = transition_[state_][dictionary_[uchar(s_[pos_])]];
             if (move < 0) {
                 state_ = move;
                 break;
@@ -48,123 +728,267 @@ public:
             state_ = move & 0x0f;
             if (actions_[move]) (this->*actions_[move])();
 
-        } while(++pos_ < s_.length() && !(state_ < 0));
-
-        state_ = pos_ == s_.length() ? -1 : state_;
-        if (state_ == -1) clear();
-    }
+            if (state_ < 0) break;
+            ++pos_;
+        }
 
-    json() = default;
-    ~json() = default;
+        // Keep the beginning of a token which continues in the next chunk
+        if (!last && (state_ == 2 || state_ == 5 || state_ >= 9)) {
+            carry_.append(s_.substr(b_));
+            carrying_ = true;
+        }
 
-    using Array = std::vector<std::string>;
+        s_ = {};
+        const size_t consumed = state_ == -2 ? pos_ + 1 : pos_;
 
-    bool is_valid() { return state_ == -2 ? true : false;  };
+        MJSON_STAT(stats_.bytes_scanned += consumed);
+        MJSON_STAT(stats_.time += std::chrono::steady_clock::now() - started);
+        return consumed;
+    }
 
-    std::string const& operator[] (const std::string& key) { return kvm_[key]; }
+    // No more input: an unfinished document is not valid
+    void finish() { state_ = state_ == -2 ? -2 : -1; }
 
-    bool has(const std::string& key) { return kvm_.find(key) != kvm_.end(); }
-    std::string const& get (const std::string& key) { return kvm_[key]; }
+    // Objects and arrays nested deeper are a format error
+    void set_max_depth(size_t depth) { max_depth_ = depth; }
 
-    bool has_array(const std::string& key) { return kam_.find(key) != kam_.end(); }
-    Array const& get_array(const std::string& key) { return kam_[key]; }
+    void reset() {
+        MJSON_STAT(stats_ = {});
+        state_ = 0;
+        nesting_.clear();
+        carrying_ = false;
+        carry_.clear();
+        escaped_ = false;
+    }
 
-    bool has_object(const std::string& key) { return kom_.find(key) != kom_.end(); }
-    json& get_object(const std::string& key) { return kom_[key]; }
+    // -1 is format error; -2 is valid json string is finished
+    char state() const { return state_; }
 
-    size_t size() { return kvm_.size() + kam_.size() + kom_.size(); };
+#ifdef MJSON_STATS
+    const parse_stats& stats() const { return stats_; }
+#endif
 
 private:
-    std::string s_{};
+    Handler& h_;
+    MJSON_STAT(parse_stats stats_{};)
+
+    std::string_view s_{};
     size_t pos_{};
     char state_{};
 
-    using KeyObjectMap = std::map<std::string, json>;
-    using KeyValueMap = std::map<std::string, std::string>;
-    using KeyArrayMap = std::map<std::string, Array>;
-    using Dictionary = std::array<char, 126>;
-    using Action = void (json::*)();
-    using Actions = std::array<Action, 0x31>;
+    using Dictionary = std::array<char, 256>;
+    using Action = void (fsm::*)();
+    using Actions = std::array<Action, 0x60>;
 
-    std::string k_{};
-    std::string v_{};
+    nesting nesting_{};
+    size_t max_depth_{ default_max_depth };
 
-    bool is_array_{};
-    Array array_{};
+    // Start of the key, string or scalar being consumed
+    size_t b_{};
 
-    KeyObjectMap kom_{};
-    KeyArrayMap kam_{};
-    KeyValueMap kvm_{};
+    // A key or value split between chunks
+    bool carrying_{};
+    std::string carry_{};
 
-    void clear() {
-        kom_.clear();
-        kam_.clear();
-        kvm_.clear();
-    }
+    // The key or string being consumed has escapes, decoded into text_
+    bool escaped_{};
+    std::string text_{};
 
     //
     // Transition matrix.
     //
     //        code (dictionary)
     //       default (if none of the dictionary chars has been found)
-    //         0     1     2     3     4     5     6     7     8     9     a     b
-    //         *    ' '   \t    \n    \r     "     :     ,     {     }     [     ]     state (transition)
-    // -1 is format error; -2 is valid json string is finished
-    static constexpr char transition_[9][12] = {
-    /*0*/  {   -1,    0,    0,    0,    0,   -1,   -1,   -1,    1,   -1,   -1,   -1 }, // 0 - Json header
-    /*1*/  {   -1,    1,    1,    1,    1, 0x12,   -1,   -1,   -1,   -2,   -1,   -1 }, // 1 - Key; 12 - key start; or '}' - object end
-    /*2*/  { 0x22, 0x22,   -1,   -1,   -1, 0x13, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22 }, // 2 - Key; 22 - consume 13 - end
-    /*3*/  {   -1,    3,    3,    3,    3,   -1,    4,   -1,   -1,   -1,   -1,   -1 }, // 3 - ':' separator expected
-    /*4*/  {   -1,    4,    4,    4,    4, 0x15,   -1,   -1, 0x19,   -1, 0x18,   -1 }, // 4 - Value; 15 - start, 18 - array start, 19 - object start
-    /*5*/  { 0x25, 0x25,   -1,   -1,   -1, 0x16, 0x25, 0x25, 0x25, 0x25, 0x25, 0x25 }, // 5 - Value; 25 - consume 16 - end
-    /*6*/  {   -1,    6,    6,    6,    6,   -1,   -1,    7,   -1,   -2,   -1, 0x26 }, // 6 - ',' sequence or '}' - object end
-    /*7*/  {   -1,    7,    7,    7,    7, 0x12,   -1,   -1,   -1,   -1,   -1,   -1 }, // 7 - The next key should start
-    /*8*/  {   -1,    8,    8,    8,    8, 0x15,   -1,   -1,   -1,   -1,   -1, 0x26 }, // 8 - Array;
-    /*X*///{   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1 }, // X - 
+    //         0     1     2     3     4     5     6     7     8     9     a     b     c     d
+    //         *    ' '   \t    \n    \r     "     :     ,     {     }     [     ]   scalar   \    state (transition)
+    // -1 is format error; -2 is set when the outermost object ends
+    static constexpr char transition_[12][14] = {
+    /*0*/  {   -1,    0,    0,    0,    0,   -1,   -1,   -1, 0x11,   -1,   -1,   -1,   -1,   -1 }, // 0 - Json header; 11 - object start
+    /*1*/  {   -1,    1,    1,    1,    1, 0x12,   -1,   -1,   -1, 0x36,   -1,   -1,   -1,   -1 }, // 1 - Key; 12 - key start; or 36 - object end
+    /*2*/  { 0x22, 0x22,   -1,   -1,   -1, 0x13, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x5a }, // 2 - Key; 22 - consume 13 - end, 5a - escape
+    /*3*/  {   -1,    3,    3,    3,    3,   -1,    4,   -1,   -1,   -1,   -1,   -1,   -1,   -1 }, // 3 - ':' separator expected
+    /*4*/  {   -1,    4,    4,    4,    4, 0x15,   -1,   -1, 0x11,   -1, 0x18,   -1, 0x19,   -1 }, // 4 - Value; 15 - start, 18 - array start, 11 - object start, 19 - scalar start
+    /*5*/  { 0x25, 0x25,   -1,   -1,   -1, 0x16, 0x25, 0x25, 0x25, 0x25, 0x25, 0x25, 0x25, 0x5b }, // 5 - Value; 25 - consume 16 - end, 5b - escape
+    /*6*/  {   -1,    6,    6,    6,    6,   -1,   -1, 0x37,   -1, 0x36,   -1, 0x26,   -1,   -1 }, // 6 - ',' sequence, 36 - object end or 26 - array end
+    /*7*/  {   -1,    7,    7,    7,    7, 0x12,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1 }, // 7 - The next key should start
+    /*8*/  {   -1,    8,    8,    8,    8, 0x15,   -1,   -1, 0x11,   -1, 0x18, 0x26, 0x19,   -1 }, // 8 - Array; the first item or 26 - array end
+    /*9*/  { 0x09, 0x46, 0x46, 0x46, 0x46,   -1,   -1, 0x46,   -1, 0x46,   -1, 0x46, 0x09, 0x09 }, // 9 - Number or literal; 09 - consume 46 - end
+    /*a*/  { 0x02, 0x02,   -1,   -1,   -1, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02 }, // a - Escaped char of a key; back to 2
+    /*b*/  { 0x05, 0x05,   -1,   -1,   -1, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05 }, // b - Escaped char of a value; back to 5
+    /*X*///{   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1 }, // X - 
     };
 
-    void onKeyChar() { k_ += s_.at(pos_); }
-    void onValueChar() { v_ += s_.at(pos_); }
-    void onArrayBegin() { is_array_ = true; }
-    void onKeyStart() { state_ = is_array_ ? 5 : state_; }
-    void onKeyEnd() { state_ = (kvm_.find(k_) != kvm_.end()) ? -1 : state_; }
-    void onValueStart() { }
+    // Key and value characters are consumed by the transitions alone; the
+    // string is sliced out of the input once its closing quote is found
+    std::string_view token() {
+        if (!carrying_) return s_.substr(b_, pos_ - b_);
+
+        carrying_ = false;
+        carry_.append(s_.substr(b_, pos_ - b_));
+        return carry_;
+    }
+
+    void start() {
+        b_ = pos_ + 1;
+        carry_.clear();
+        escaped_ = false;
+    }
+
+    // The escapes are only checked and decoded once the string ends
+    void onEscape() { escaped_ = true; }
+
+    // Decodes the token if it has escapes; an empty optional is a bad escape
+    std::optional<std::string_view> decoded(std::string_view raw) {
+        if (!escaped_) return raw;
+
+        MJSON_STAT(++stats_.actions[parse_stats::escaped]);
+        if constexpr (raw_strings<Handler>::value) {
+            null_text checked;
+            if (!unescape(raw, checked)) return std::nullopt;
+            return raw;
+        } else {
+            if (!unescape(raw, text_)) return std::nullopt;
+            return std::string_view(text_);
+        }
+    }
 
     void onObjectBegin() {
-        json obj(s_.data() + pos_);
-        if (!obj.is_valid()) {
+        if (nesting_.size() == max_depth_) {
             state_ = -1;
             return;
         }
 
-        kom_.insert(KeyObjectMap::value_type(k_, std::move(obj)));
-        k_.clear();
-        pos_ += obj.pos_;
-        state_ = 6;
+        if constexpr (can_skip<Handler>::value) {
+            if (nesting_.size() && h_.skip_object() && skip()) return;
+        }
+
+        nesting_.push(false);
+        MJSON_STAT(++stats_.actions[parse_stats::object_begin]);
+        MJSON_STAT(stats_.max_depth = std::max(stats_.max_depth, nesting_.size()));
+        state_ = h_.on_object_begin() ? state_ : -1;
     }
 
-    void onArrayEnd() {
-        if (!is_array_) {
+    // Skips the object which starts at pos_; returns false if it does not
+    // end in this chunk, so it is parsed as usual
+    bool skip() {
+        const char* const b = s_.data();
+        const char* const e = b + s_.length();
+
+        const char* p = match_braces(b + pos_, e);
+        if (p == e) return false;
+        if (!p) {
+            state_ = -1;
+            return true;
+        }
+
+        MJSON_STAT(++stats_.actions[parse_stats::object_skipped]);
+        state_ = h_.on_object_skipped(s_.substr(pos_, p - b + 1 - pos_)) ? 6 : -1;
+        pos_ = p - b;
+        return true;
+    }
+
+    void onObjectEnd() {
+        MJSON_STAT(++stats_.actions[parse_stats::object_end]);
+        if (nesting_.in_array() || !h_.on_object_end()) {
             state_ = -1;
             return;
         }
 
-        is_array_ = false;
-        kam_.insert(KeyArrayMap::value_type(k_, array_));
-        array_.clear();
-        k_.clear();
+        nesting_.pop();
+        state_ = nesting_.size() ? state_ : -2;
+    }
+
+    // The next member of an object or the next item of an array
+    void onComma() { state_ = nesting_.in_array() ? 4 : state_; }
+
+    void onKeyStart() {
+        MJSON_STAT(++stats_.actions[parse_stats::key_start]);
+        start();
+    }
+
+    void onKeyEnd() {
+        MJSON_STAT(++stats_.actions[parse_stats::key_end]);
+        const std::string_view raw = token();
+        const auto key = decoded(raw);
+        state_ = key && h_.on_key(*key, raw) ? state_ : -1;
+    }
+
+    void onValueStart() {
+        MJSON_STAT(++stats_.actions[parse_stats::value_start]);
+        start();
     }
 
     void onValueEnd() {
-        if (is_array_) {
-            array_.push_back(v_);
-            v_.clear();
+        MJSON_STAT(++stats_.actions[parse_stats::value_end]);
+        const std::string_view raw = token();
+        const auto value = decoded(raw);
+        state_ = value && h_.on_string(*value, raw) ? state_ : -1;
+    }
+
+    void onArrayBegin() {
+        if (nesting_.size() == max_depth_) {
+            state_ = -1;
+            return;
+        }
+
+        MJSON_STAT(++stats_.actions[parse_stats::array_begin]);
+        nesting_.push(true);
+        MJSON_STAT(stats_.max_depth = std::max(stats_.max_depth, nesting_.size()));
+        state_ = h_.on_array_begin() ? state_ : -1;
+    }
+
+    void onArrayEnd() {
+        MJSON_STAT(++stats_.actions[parse_stats::array_end]);
+        if (!nesting_.in_array() || !h_.on_array_end()) {
+            state_ = -1;
             return;
         }
 
-        kvm_.insert(KeyValueMap::value_type(k_, v_));
-        k_.clear();
-        v_.clear();
+        nesting_.pop();
+    }
+
+    // A number or a literal is consumed up to the delimiter at once when it
+    // is in this chunk; otherwise it continues in state 9
+    void onScalarStart() {
+        b_ = pos_;
+        carry_.clear();
+
+        const char* const b = s_.data();
+        const char* const e = b + s_.length();
+        const char* p = b + pos_ + 1;
+        while (p < e && dictionary_[uchar(*p)] - 1u >= 11u) ++p;
+
+        pos_ = p - b;
+        if (p < e) {
+            state_ = 6;
+            onScalarEnd();
+        } else {
+            --pos_;
+        }
+    }
+
+    // The delimiter is taken again as the char after the value
+    void onScalarEnd() {
+        scalar(token());
+        if (state_ >= 0) --pos_;
+    }
+
+    void scalar(std::string_view t) {
+        switch (t[0]) {
+        case 't':
+        case 'f':
+        case 'n':
+            MJSON_STAT(++stats_.actions[parse_stats::literal]);
+            if (t == "true" || t == "false") state_ = h_.on_bool(t[0] == 't') ? state_ : -1;
+            else if (t == "null") state_ = h_.on_null() ? state_ : -1;
+            else state_ = -1;
+            break;
+        default: {
+            MJSON_STAT(++stats_.actions[parse_stats::number]);
+            number n;
+            state_ = parse_number(t, n) && h_.on_number(n) ? state_ : -1;
+        }
+        }
     }
 
     static constexpr Dictionary dictionary_ = []() {
@@ -181,25 +1005,3279 @@ private:
         dic['}'] = 9;
         dic['['] = 10;
         dic[']'] = 11;
+        dic['\\'] = 13;
+
+        dic['-'] = 12;
+        for (char c = '0'; c <= '9'; c++) dic[c] = 12;
+        dic['t'] = 12;
+        dic['f'] = 12;
+        dic['n'] = 12;
 
         return dic;
     }();
 
-    const Actions actions_ = []() {
+    // Shared by all the parsers
+    static constexpr Actions actions_ = []() {
         Actions h{};
 
-        h[0x12] = &json::onKeyStart;
-        h[0x13] = &json::onKeyEnd;
-        h[0x15] = &json::onValueStart;
-        h[0x16] = &json::onValueEnd;
-        h[0x18] = &json::onArrayBegin;
-        h[0x19] = &json::onObjectBegin;
-        h[0x22] = &json::onKeyChar;
-        h[0x25] = &json::onValueChar;
-        h[0x26] = &json::onArrayEnd;
+        h[0x11] = &fsm::onObjectBegin;
+        h[0x12] = &fsm::onKeyStart;
+        h[0x13] = &fsm::onKeyEnd;
+        h[0x15] = &fsm::onValueStart;
+        h[0x16] = &fsm::onValueEnd;
+        h[0x18] = &fsm::onArrayBegin;
+        h[0x19] = &fsm::onScalarStart;
+        h[0x26] = &fsm::onArrayEnd;
+        h[0x36] = &fsm::onObjectEnd;
+        h[0x37] = &fsm::onComma;
+        h[0x46] = &fsm::onScalarEnd;
+        h[0x5a] = &fsm::onEscape;
+        h[0x5b] = &fsm::onEscape;
 
         return h;
     }();
 };
 
+} // namespace detail
+
+//
+// Read-only memory mapping of a whole file. The pages are read on demand and
+// the kernel is advised of the sequential access, so the file is parsed
+// without being copied into the process memory first.
+//
+class mapped_file {
+public:
+    explicit mapped_file(const std::string& path) {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+
+        LARGE_INTEGER size{};
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                size_ = data_ ? static_cast<size_t>(size.QuadPart) : 0;
+                CloseHandle(mapping);
+            }
+        }
+        opened_ = data_ || size.QuadPart == 0;
+        CloseHandle(file);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat st{};
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data_ = static_cast<const char*>(p);
+                size_ = static_cast<size_t>(st.st_size);
+#ifdef MADV_SEQUENTIAL
+                ::madvise(p, size_, MADV_SEQUENTIAL);
+#endif
+            }
+        }
+        opened_ = data_ || st.st_size == 0;
+        ::close(fd);
+#endif
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    ~mapped_file() {
+        if (!data_) return;
+#if defined(_WIN32)
+        UnmapViewOfFile(data_);
+#else
+        ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    // The file exists and is mapped; an empty file has no mapping
+    bool is_open() const { return opened_; }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+private:
+    const char* data_{};
+    size_t size_{};
+    bool opened_{};
+};
+
+namespace detail {
+
+// Hash of a key fed in pieces, e.g. as the output of unescape()
+class key_hash {
+public:
+    void clear() { h_ = 14695981039346656037ull; }
+    void append(const char* p, size_t n) {
+        for (const char* e = p + n; p < e; ++p) *this += *p;
+    }
+    void operator+=(char c) { h_ = (h_ ^ uchar(c)) * 1099511628211ull; }
+
+    size_t value() const { return static_cast<size_t>(h_ ^ (h_ >> 32)); }
+
+private:
+    uint64_t h_{ 14695981039346656037ull };
+};
+
+inline size_t hash_key(std::string_view key) {
+    key_hash h;
+    h.append(key.data(), key.size());
+    return h.value();
+}
+
+} // namespace detail
+
+//
+// The key of a lookup: any string, or a key of a key_table. An interned key
+// carries its hash, and a document built with the same table tells it by its
+// address, so the lookup neither hashes nor compares the chars.
+//
+class key_ref {
+public:
+    template <class S, class = std::enable_if_t<std::is_convertible_v<const S&, std::string_view>>>
+    key_ref(const S& name) : name_(name) {}
+
+    std::string_view name() const { return name_; }
+    size_t hash() const { return interned_ ? hash_ : detail::hash_key(name_); }
+    bool interned() const { return interned_; }
+
+private:
+    friend class key_table;
+
+    std::string_view name_;
+    size_t hash_{};
+    bool interned_{};
+};
+
+//
+// Pool of the keys shared by many documents, e.g. the messages of one kind
+// which repeat the same few dozen keys. The documents parsed with the table
+// keep no copies of their keys, only their addresses in the pool. Keys are
+// never removed, so the table must outlive the documents and the keys taken
+// from it. It may be shared between threads: a key which is in the pool
+// already is found under a shared lock. The pool holds up to max_size keys,
+// so documents with ever new keys cannot grow it without bound; the keys
+// past it are not interned and each document keeps its own copy.
+//
+//    mjson::key_table keys;
+//    const mjson::key_ref server = keys.intern("Server");
+//
+//    mjson::parser p(mjson::options{ false, mjson::default_max_depth, &keys });
+//    while (receive(msg))
+//        if (p.parse(msg, js)) connect(js[server]);
+//
+class key_table {
+public:
+    static constexpr size_t default_max_size = 65536;
+
+    explicit key_table(size_t max_size = default_max_size) : max_size_(max_size) {}
+    key_table(const key_table&) = delete;
+    key_table& operator=(const key_table&) = delete;
+
+    key_ref intern(std::string_view name) {
+        const size_t h = detail::hash_key(name);
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            if (const key_ref* k = lookup(name, h)) return *k;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (const key_ref* k = lookup(name, h)) return *k;
+        if (count_ >= max_size_) return key_ref(name);
+
+        // Keep the load factor under 1/2
+        if (slots_.size() < (count_ + 1) * 2) {
+            std::vector<key_ref> old(slots_.empty() ? 64 : slots_.size() * 2, key_ref(std::string_view()));
+            old.swap(slots_);
+            for (const key_ref& k : old)
+                if (k.name_.data()) insert(k);
+        }
+
+        names_.emplace_front(name);
+        key_ref k(names_.front());
+        k.hash_ = h;
+        k.interned_ = true;
+        insert(k);
+        ++count_;
+        return k;
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return count_;
+    }
+
+private:
+    const key_ref* lookup(std::string_view name, size_t h) const {
+        if (slots_.empty()) return nullptr;
+
+        const size_t mask = slots_.size() - 1;
+        for (size_t i = h & mask; slots_[i].name_.data(); i = (i + 1) & mask)
+            if (slots_[i].hash_ == h && slots_[i].name_ == name) return &slots_[i];
+        return nullptr;
+    }
+
+    void insert(const key_ref& k) {
+        const size_t mask = slots_.size() - 1;
+        size_t i = k.hash_ & mask;
+        while (slots_[i].name_.data()) i = (i + 1) & mask;
+        slots_[i] = k;
+    }
+
+    mutable std::shared_mutex mutex_;
+    std::vector<key_ref> slots_{};          // a null name is a free slot
+    std::forward_list<std::string> names_{};
+    size_t count_{};
+    size_t max_size_{};
+};
+
+// Parsing options
+struct options {
+    // Nested objects are only matched by their braces while the document is
+    // parsed; each of them is parsed on the first access to it
+    bool lazy = false;
+
+    // Maximum nesting depth of objects and arrays, the outermost object
+    // included
+    size_t max_depth = default_max_depth;
+
+    // Keys are interned in the table instead of being copied
+    key_table* keys = nullptr;
+};
+
+// Kind of an object member or a list item. An array of strings is an array;
+// an array with any other items is a list.
+enum class kind : unsigned char { string, array, object, number, boolean, null, list };
+
+template <class Json>
+class basic_stream_parser;
+
+namespace detail {
+template <class Json>
+class parallel_parser;
+} // namespace detail
+
+//
+// The parser is shared between two flavours of the document:
+//    - json      : keys and values are copied into std::string
+//    - json_view : keys and values are std::string_view slices of the input
+//
+// A json_view constructed from an rvalue std::string takes ownership of the
+// buffer; otherwise the caller keeps the input alive while the view is used.
+//
+// All the containers of a document, including its nested objects, allocate
+// through the Allocator passed to the constructor. The pmr flavours accept a
+// std::pmr::memory_resource, e.g. a monotonic arena which is released at once
+// after the document is destroyed.
+//
+// Members of an object are kept in a flat table in the document order. Small
+// objects are searched linearly and large ones through a hash index.
+//
+// Arrays of strings, the usual case, are kept as Array. An array which has
+// any other item is a list: a document of its own whose members have no
+// keys and are accessed by position.
+//
+template <class String, class Allocator = std::allocator<char>>
+class basic_json {
+    template <class T>
+    using rebind = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+public:
+    basic_json(std::string_view s, const Allocator& alloc = Allocator())
+        : basic_json(s, options(), alloc) {}
+
+    basic_json(const char* s, const Allocator& alloc = Allocator())
+        : basic_json(std::string_view(s), alloc) {}
+    basic_json(const std::string& s, const Allocator& alloc = Allocator())
+        : basic_json(std::string_view(s), alloc) {}
+    basic_json(std::string&& s, const Allocator& alloc = Allocator())
+        : basic_json(adopt(std::move(s), options(), alloc)) {}
+
+    // A lazy json keeps a copy of the input for the objects not parsed yet
+    basic_json(std::string_view s, const options& opt, const Allocator& alloc = Allocator())
+        : basic_json(alloc) {
+        if (opt.lazy && !is_view_) {
+            *this = adopt(std::string(s), opt, alloc);
+            return;
+        }
+
+        options_ = opt;
+        parse(s);
+    }
+
+    basic_json(const char* s, const options& opt, const Allocator& alloc = Allocator())
+        : basic_json(std::string_view(s), opt, alloc) {}
+    basic_json(const std::string& s, const options& opt, const Allocator& alloc = Allocator())
+        : basic_json(std::string_view(s), opt, alloc) {}
+    basic_json(std::string&& s, const options& opt, const Allocator& alloc = Allocator())
+        : basic_json(adopt(std::move(s), opt, alloc)) {}
+
+    explicit basic_json(const Allocator& alloc)
+        : keys_(make_string({}, alloc)), entries_(alloc), index_(alloc),
+          values_(alloc), numbers_(alloc), arrays_(alloc), objects_(alloc) {}
+
+    basic_json() = default;
+    basic_json(const basic_json&) = default;
+    basic_json(basic_json&&) = default;
+    basic_json& operator=(const basic_json&) = default;
+    basic_json& operator=(basic_json&&) = default;
+    ~basic_json() = default;
+
+    //
+    // Parses the file straight from its mapped pages. A json copies the keys
+    // and values out and unmaps the file; a view keeps the mapping alive for
+    // its own lifetime. A missing file gives an invalid document.
+    //
+    static basic_json from_file(const std::string& path, const Allocator& alloc = Allocator()) {
+        return from_file(path, options(), alloc);
+    }
+
+    static basic_json from_file(const std::string& path, const options& opt,
+                                const Allocator& alloc = Allocator()) {
+        auto file = std::make_shared<const mapped_file>(path);
+
+        basic_json js(alloc);
+        if (!file->is_open()) {
+            js.state_ = -1;
+            return js;
+        }
+
+        if (is_view_ || opt.lazy) js.owner_ = file;
+        js.options_ = opt;
+        js.parse(file->view());
+        return js;
+    }
+
+    using Array = std::vector<String, rebind<String>>;
+
+    Allocator get_allocator() const { return Allocator(entries_.get_allocator()); }
+
+    bool is_valid() const { return state_ == -2 ? true : false;  };
+
+    //
+    // The lookups by key take any string without a copy, or a key of the
+    // key_table the document is parsed with. They never insert nor allocate,
+    // so a const document may be read by many threads at once with no
+    // locking. Only the non-const get_object() and get_list() parse a lazy
+    // object on the first access, and need the document to themselves while
+    // they do; on a const document an object not parsed yet reads as missing,
+    // as find_object() and find_list() do not find it.
+    //
+
+    // Missing keys are not inserted; an empty value is returned instead
+    String const& operator[] (key_ref key) const { return get(key); }
+
+    bool has(key_ref key) const { return locate(key, kind::string) != npos; }
+    String const& get (key_ref key) const { return value_at(locate(key, kind::string), values_); }
+
+    bool has_array(key_ref key) const { return locate(key, kind::array) != npos; }
+    Array const& get_array(key_ref key) const { return value_at(locate(key, kind::array), arrays_); }
+
+    bool has_object(key_ref key) const { return locate(key, kind::object) != npos; }
+    basic_json& get_object(key_ref key) { return object_at(locate(key, kind::object)); }
+    const basic_json& get_object(key_ref key) const { return object_at(locate(key, kind::object)); }
+
+    // Missing members read as 0, false and an empty list
+    bool has_number(key_ref key) const { return locate(key, kind::number) != npos; }
+    number get_number(key_ref key) const { return value_at(locate(key, kind::number), numbers_); }
+    int64_t get_int(key_ref key) const { return get_number(key).as_int(); }
+    double get_double(key_ref key) const { return get_number(key).as_double(); }
+
+    bool has_bool(key_ref key) const { return locate(key, kind::boolean) != npos; }
+    bool get_bool(key_ref key) const { return locate(key, kind::boolean) == 1; }
+
+    bool is_null(key_ref key) const { return locate(key, kind::null) != npos; }
+
+    bool has_list(key_ref key) const { return locate(key, kind::list) != npos; }
+    basic_json& get_list(key_ref key) { return object_at(locate(key, kind::list)); }
+    const basic_json& get_list(key_ref key) const { return object_at(locate(key, kind::list)); }
+
+    // Missing members, and members of another kind, are nullptr or nothing
+    const String* find(key_ref key) const { return pointer_at(locate(key, kind::string), values_); }
+    const Array* find_array(key_ref key) const { return pointer_at(locate(key, kind::array), arrays_); }
+    const basic_json* find_object(key_ref key) const { return parsed_at(locate(key, kind::object)); }
+    const basic_json* find_list(key_ref key) const { return parsed_at(locate(key, kind::list)); }
+
+    std::optional<number> find_number(key_ref key) const {
+        const size_t i = locate(key, kind::number);
+        return i != npos ? std::optional<number>(numbers_[i]) : std::nullopt;
+    }
+
+    std::optional<bool> find_bool(key_ref key) const {
+        const size_t i = locate(key, kind::boolean);
+        return i != npos ? std::optional<bool>(i == 1) : std::nullopt;
+    }
+
+    size_t size() const { return entries_.size(); };
+
+#ifdef MJSON_STATS
+    // Counters of the parse which built this document
+    const parse_stats& stats() const { return stats_; }
+#endif
+
+    // Members by position in the document order, 0 <= i < size()
+    std::string_view key(size_t i) const { return key_of(entries_[i]); }
+    kind kind_of(size_t i) const { return entries_[i].type; }
+
+    String const& get(size_t i) const { return value_at(at(i, kind::string), values_); }
+    Array const& get_array(size_t i) const { return value_at(at(i, kind::array), arrays_); }
+    basic_json& get_object(size_t i) { return object_at(at(i, kind::object)); }
+    const basic_json& get_object(size_t i) const { return object_at(at(i, kind::object)); }
+    number get_number(size_t i) const { return value_at(at(i, kind::number), numbers_); }
+    bool get_bool(size_t i) const { return at(i, kind::boolean) == 1; }
+    basic_json& get_list(size_t i) { return object_at(at(i, kind::list)); }
+    const basic_json& get_list(size_t i) const { return object_at(at(i, kind::list)); }
+
+private:
+    template <class Json>
+    friend class basic_stream_parser;
+
+    template <class Json>
+    friend class basic_document_stream;
+
+    template <class Json>
+    friend class basic_parser;
+
+    template <class Json>
+    friend class detail::parallel_parser;
+
+    static constexpr bool is_view_ = std::is_same_v<String, std::string_view>;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // Objects up to this size are searched without the hash index
+    static constexpr size_t linear_ = 8;
+
+    // -1 is format error; -2 is valid json string is finished
+    char state_{};
+
+    // Keeps the input alive for views which own their buffer
+    std::shared_ptr<const void> owner_{};
+
+    options options_{};
+
+    // The text of a lazy object which is not parsed yet
+    std::string_view pending_{};
+
+    // The members of a list have no keys and are not indexed
+    bool list_{};
+
+    struct entry {
+        size_t key;         // offset of the key in keys_
+        uint32_t length;    // length of the key
+        uint32_t index;     // position in the container of the member kind;
+                            // the value of a boolean
+        kind type;
+    };
+
+    // A json copies the keys into one buffer; a view refers to the input
+    String keys_{};
+
+    std::vector<entry, rebind<entry>> entries_{};
+    std::vector<uint32_t, rebind<uint32_t>> index_{};   // entry + 1; 0 is a free slot
+
+    std::vector<String, rebind<String>> values_{};
+    std::vector<number, rebind<number>> numbers_{};
+    std::vector<Array, rebind<Array>> arrays_{};
+    std::vector<basic_json, rebind<basic_json>> objects_{};   // and lists
+
+    // Keys and strings of a view which had escapes are decoded out of the
+    // input; the list keeps them in place while the object grows
+    using decoded_text = std::basic_string<char, std::char_traits<char>, rebind<char>>;
+    std::shared_ptr<std::forward_list<decoded_text, rebind<decoded_text>>> decoded_{};
+
+    // Nested objects, arrays and strings of the parsed documents kept with
+    // their capacity for the next ones
+    struct pool {
+        std::vector<basic_json> objects;
+        std::vector<Array> arrays;
+        std::vector<String> strings;
+    };
+
+    void recycle(pool& spare) {
+        for (auto& obj : objects_) {
+            obj.recycle(spare);
+            spare.objects.push_back(std::move(obj));
+        }
+
+        for (auto& arr : arrays_) {
+            if constexpr (!is_view_)
+                for (auto& v : arr) spare.strings.push_back(std::move(v));
+            arr.clear();
+            spare.arrays.push_back(std::move(arr));
+        }
+
+        if constexpr (!is_view_)
+            for (auto& v : values_) spare.strings.push_back(std::move(v));
+
+        clear();
+        state_ = 0;
+        owner_.reset();
+        pending_ = {};
+    }
+
+    //
+    // Builds the document from the state machine tokens. Objects and lists
+    // are built in place: the stack holds the ones which are not finished
+    // yet. An array is collected as an array of strings until an item of
+    // another kind shows it is a list.
+    //
+    class builder {
+    public:
+        explicit builder(basic_json& root, pool* spare = nullptr)
+            : root_(&root), spare_(spare), array_(root.get_allocator()) {
+            stack_.reserve(32);
+        }
+
+        // Builds the next document into another object
+        void rebind(basic_json& root) { root_ = &root; }
+
+        void reset() {
+            stack_.clear();
+            array_.clear();
+            in_array_ = false;
+            MJSON_STAT(allocations_ = bytes_allocated_ = 0);
+        }
+
+        bool on_object_begin() {
+            if (stack_.empty()) {
+                stack_.push_back(root_);
+                return true;
+            }
+
+            if (in_array_) to_list();
+            MJSON_STAT(growth g(*this));
+            stack_.push_back(&add_object(kind::object));
+            return true;
+        }
+
+        bool skip_object() { return root_->options_.lazy; }
+
+        bool on_object_skipped(std::string_view raw) {
+            if (in_array_) to_list();
+            MJSON_STAT(growth g(*this));
+            basic_json& obj = add_object(kind::object);
+            obj.pending_ = raw;
+            obj.state_ = 0;
+
+            // The object is as deep as the open ones already
+            obj.options_.max_depth = root_->options_.max_depth - stack_.size();
+            return true;
+        }
+
+        bool on_object_end() {
+            stack_.back()->state_ = -2;
+            stack_.pop_back();
+
+            // The items of a list which follow have no key; an object's next
+            // member sets its own
+            key_ = 0;
+            length_ = 0;
+            return true;
+        }
+
+        bool on_key(std::string_view key, std::string_view raw) {
+            basic_json& top = *stack_.back();
+            key_table* const table = root_->options_.keys;
+            const key_ref k = table ? table->intern(key) : key_ref(key);
+            if (top.locate(k) != npos) return false;
+
+            MJSON_STAT(growth g(*this));
+            length_ = static_cast<uint32_t>(key.length());
+            if (k.interned()) {
+                key_ = top.offset_of(k.name());
+            } else if (is_view_ || table) {
+                // A key past a full table is kept where it does not move, as
+                // the decoded keys of a view are
+                if (!is_view_ || key.data() != raw.data()) key = top.keep(key);
+                key_ = top.offset_of(key);
+            } else if constexpr (!is_view_) {
+                key_ = top.keys_.length();
+                top.keys_ += key;
+            }
+            return true;
+        }
+
+        bool on_string(std::string_view value, std::string_view raw) {
+            basic_json& top = *stack_.back();
+            if constexpr (is_view_)
+                if (value.data() != raw.data()) value = top.keep(value);
+            String str = new_string(value, top.get_allocator());
+
+            MJSON_STAT(growth g(*this));
+            if (in_array_) {
+                array_.push_back(std::move(str));
+                return true;
+            }
+
+            top.values_.push_back(std::move(str));
+            top.add_entry(kind::string, top.values_.size() - 1, key_, length_);
+            return true;
+        }
+
+        bool on_number(number value) {
+            if (in_array_) to_list();
+
+            basic_json& top = *stack_.back();
+            MJSON_STAT(growth g(*this));
+            top.numbers_.push_back(value);
+            top.add_entry(kind::number, top.numbers_.size() - 1, key_, length_);
+            return true;
+        }
+
+        bool on_bool(bool value) {
+            if (in_array_) to_list();
+
+            MJSON_STAT(growth g(*this));
+            stack_.back()->add_entry(kind::boolean, value, key_, length_);
+            return true;
+        }
+
+        bool on_null() {
+            if (in_array_) to_list();
+
+            MJSON_STAT(growth g(*this));
+            stack_.back()->add_entry(kind::null, 0, key_, length_);
+            return true;
+        }
+
+        bool on_array_begin() {
+            if (in_array_) to_list();
+
+            in_array_ = true;
+            if (spare_ && !array_.capacity() && !spare_->arrays.empty()) {
+                array_ = std::move(spare_->arrays.back());
+                spare_->arrays.pop_back();
+            }
+            return true;
+        }
+
+        bool on_array_end() {
+            // The list on the top is finished
+            if (!in_array_) return on_object_end();
+
+            basic_json& top = *stack_.back();
+            MJSON_STAT(growth g(*this));
+            top.arrays_.push_back(std::move(array_));
+            top.add_entry(kind::array, top.arrays_.size() - 1, key_, length_);
+
+            array_.clear();
+            in_array_ = false;
+            return true;
+        }
+
+    private:
+        // The array being collected has an item which is not a string: its
+        // strings are moved into a new list, which takes the next items
+        void to_list() {
+            MJSON_STAT(growth g(*this));
+            basic_json& list = add_object(kind::list);
+            list.decoded_ = stack_.back()->decoded_;
+            for (auto& v : array_) {
+                list.values_.push_back(std::move(v));
+                list.add_entry(kind::string, list.values_.size() - 1, 0, 0);
+            }
+
+            array_.clear();
+            in_array_ = false;
+            stack_.push_back(&list);
+            key_ = 0;
+            length_ = 0;
+        }
+
+        String new_string(std::string_view value, const Allocator& alloc) {
+            if constexpr (!is_view_) {
+                if (spare_ && !spare_->strings.empty()) {
+                    String str = std::move(spare_->strings.back());
+                    spare_->strings.pop_back();
+
+                    MJSON_STAT(const size_t before = footprint(str));
+                    str.assign(value.data(), value.size());
+                    MJSON_STAT(grown(before, str));
+                    return str;
+                }
+            }
+
+            String str = make_string(value, alloc);
+            MJSON_STAT(grown(footprint(String()), str));
+            return str;
+        }
+
+        basic_json& add_object(kind type) {
+            basic_json& top = *stack_.back();
+            if (spare_ && !spare_->objects.empty()) {
+                top.objects_.push_back(std::move(spare_->objects.back()));
+                spare_->objects.pop_back();
+            } else {
+                top.objects_.emplace_back(top.get_allocator());
+            }
+            top.add_entry(type, top.objects_.size() - 1, key_, length_);
+
+            basic_json& obj = top.objects_.back();
+            obj.owner_ = root_->owner_;
+            obj.options_ = root_->options_;
+            obj.list_ = type == kind::list;
+            if constexpr (is_view_) obj.keys_ = root_->keys_;
+            return obj;
+        }
+
+        basic_json* root_;
+        pool* spare_;
+        std::vector<basic_json*> stack_{};
+
+        // The key waiting for its value
+        size_t key_{};
+        uint32_t length_{};
+
+        bool in_array_{};
+        Array array_;
+
+#ifdef MJSON_STATS
+    public:
+        size_t allocations_{};
+        size_t bytes_allocated_{};
+
+    private:
+        template <class C>
+        static size_t footprint(const C& c) {
+            if constexpr (std::is_same_v<C, std::string_view>) return 0;
+            else return c.capacity() * sizeof(typename C::value_type);
+        }
+
+        // A string longer than its buffer before is allocated
+        void grown(size_t before, const String& s) {
+            if (footprint(s) <= before) return;
+            ++allocations_;
+            bytes_allocated_ += footprint(s) + 1;
+        }
+
+        // Counts the containers of the current object which have grown
+        // while it lives as allocations
+        class growth {
+        public:
+            explicit growth(builder& b) : b_(b), obj_(*b.stack_.back()), before_(footprints()) {}
+
+            ~growth() {
+                const auto after = footprints();
+                for (size_t i = 0; i < after.size(); i++) {
+                    if (after[i] <= before_[i]) continue;
+                    ++b_.allocations_;
+                    b_.bytes_allocated_ += after[i];
+                }
+            }
+
+        private:
+            std::array<size_t, 8> footprints() const {
+                return { footprint(obj_.keys_), footprint(obj_.entries_), footprint(obj_.index_),
+                         footprint(obj_.values_), footprint(obj_.numbers_), footprint(obj_.arrays_),
+                         footprint(obj_.objects_), footprint(b_.array_) };
+            }
+
+            builder& b_;
+            basic_json& obj_;
+            std::array<size_t, 8> before_;
+        };
+#endif
+    };
+
+#ifdef MJSON_STATS
+    parse_stats stats_{};
+
+    template <class Fsm>
+    void collect_stats(const Fsm& fsm, const builder& b, std::string_view input) {
+        stats_ = fsm.stats();
+        stats_.allocations = b.allocations_;
+        stats_.bytes_allocated = b.bytes_allocated_;
+        if (auto cb = detail::stats_handler()) cb(stats_, input);
+    }
+#endif
+
+    void parse(std::string_view s) {
+        if constexpr (is_view_) keys_ = s;
+
+        builder b(*this);
+        detail::fsm<builder> fsm(b);
+        fsm.set_max_depth(options_.max_depth);
+        fsm.feed(s);
+        fsm.finish();
+
+        state_ = fsm.state();
+        if (state_ == -1) clear();
+        MJSON_STAT(collect_stats(fsm, b, s));
+    }
+
+    // Parses the document fed in parts, e.g. a slice of the members of a
+    // larger document put in braces. A view refers to 'whole', which holds
+    // all the parts but the braces.
+    void parse(std::string_view whole, std::initializer_list<std::string_view> parts) {
+        if constexpr (is_view_) keys_ = whole;
+
+        builder b(*this);
+        detail::fsm<builder> fsm(b);
+        fsm.set_max_depth(options_.max_depth);
+        for (auto part : parts) fsm.feed(part);
+        fsm.finish();
+
+        state_ = fsm.state();
+        if (state_ == -1) clear();
+    }
+
+    // Moves the members of another object parsed from the same input to the
+    // end of this one; false on a duplicate key
+    bool absorb(basic_json& other) {
+        const size_t base = keys_.size();
+        const bool copied = !is_view_ && !options_.keys;
+        if constexpr (!is_view_)
+            if (copied) keys_.append(other.keys_);
+
+        // The lists of the other object share its decoded text
+        if (other.decoded_ && decoded_ != other.decoded_) {
+            if (!decoded_) {
+                decoded_ = other.decoded_;
+            } else {
+                decoded_->splice_after(decoded_->before_begin(), *other.decoded_);
+                other.share_decoded(other.decoded_.get(), decoded_);
+            }
+        }
+
+        for (const entry& e : other.entries_) {
+            if (locate(key_ref(other.key_of(e))) != npos) return false;
+
+            size_t index = e.index;
+            switch (e.type) {
+            case kind::string:
+                index = values_.size();
+                values_.push_back(std::move(other.values_[e.index]));
+                break;
+            case kind::number:
+                index = numbers_.size();
+                numbers_.push_back(other.numbers_[e.index]);
+                break;
+            case kind::array:
+                index = arrays_.size();
+                arrays_.push_back(std::move(other.arrays_[e.index]));
+                break;
+            case kind::object:
+            case kind::list:
+                index = objects_.size();
+                objects_.push_back(std::move(other.objects_[e.index]));
+                break;
+            default:
+                break;
+            }
+            add_entry(e.type, index, copied ? base + e.key : e.key, e.length);
+        }
+        return true;
+    }
+
+    void share_decoded(const void* from, const decltype(decoded_)& to) {
+        for (auto& obj : objects_) {
+            if (!obj.list_ || obj.decoded_.get() != from) continue;
+            obj.decoded_ = to;
+            obj.share_decoded(from, to);
+        }
+    }
+
+    // Only a view or a lazy json needs the buffer after parsing; json copies
+    // the strings out
+    static basic_json adopt(std::string&& s, const options& opt, const Allocator& alloc) {
+        basic_json js(alloc);
+        js.options_ = opt;
+
+        if (is_view_ || opt.lazy) {
+            auto owner = std::make_shared<const std::string>(std::move(s));
+            js.owner_ = owner;
+            js.parse(*owner);
+        } else {
+            js.parse(s);
+        }
+        return js;
+    }
+
+    // A missing member reads as an empty object of the calling thread, which
+    // is emptied again on every miss so changes made to it do not last
+    basic_json& object_at(size_t i) {
+        if (i == npos) {
+            thread_local basic_json empty{};
+            empty = basic_json();
+            return empty;
+        }
+
+        basic_json& obj = objects_[i];
+        if (obj.pending_.data()) {
+            std::string_view s = obj.pending_;
+            obj.pending_ = {};
+            obj.parse(s);
+        }
+        return obj;
+    }
+
+    // Never parses, so a lazy object which is not parsed yet reads as missing
+    const basic_json& object_at(size_t i) const {
+        const basic_json* obj = parsed_at(i);
+        return obj ? *obj : value_at(npos, objects_);
+    }
+
+    static String make_string(std::string_view s, const Allocator& alloc) {
+        if constexpr (is_view_) {
+            return s;
+        } else {
+            return String(s, alloc);
+        }
+    }
+
+    // The decoded keys of a view are out of keys_, so the offset is an
+    // integer which wraps around. Interned keys are kept by their addresses,
+    // as keys_ of a json moves with the object.
+    uintptr_t key_base() const {
+        return options_.keys ? 0 : reinterpret_cast<uintptr_t>(keys_.data());
+    }
+
+    size_t offset_of(std::string_view key) const {
+        return static_cast<size_t>(reinterpret_cast<uintptr_t>(key.data()) - key_base());
+    }
+
+    std::string_view key_of(const entry& e) const {
+        return std::string_view(reinterpret_cast<const char*>(key_base() + e.key), e.length);
+    }
+
+    std::string_view keep(std::string_view s) {
+        // A pmr list gets the resource of the document from allocate_shared
+        using list = typename decltype(decoded_)::element_type;
+        if (!decoded_) decoded_ = std::allocate_shared<list>(rebind<list>(get_allocator()));
+
+        decoded_->emplace_front(s);
+        return decoded_->front();
+    }
+
+    // An interned key is found at the same address
+    bool key_equal(const entry& e, std::string_view key) const {
+        if (e.length != key.length()) return false;
+        const std::string_view k = key_of(e);
+        return k.data() == key.data() || k == key;
+    }
+
+    // Position of the member with the given key in entries_ or npos
+    size_t locate(const key_ref& key) const {
+        if (index_.empty()) {
+            for (size_t i = 0; i < entries_.size(); i++)
+                if (key_equal(entries_[i], key.name())) return i;
+            return npos;
+        }
+
+        const size_t mask = index_.size() - 1;
+        for (size_t h = key.hash() & mask; index_[h]; h = (h + 1) & mask)
+            if (key_equal(entries_[index_[h] - 1], key.name())) return index_[h] - 1;
+        return npos;
+    }
+
+    // Position of the member in the container of its kind or npos
+    size_t locate(const key_ref& key, kind type) const {
+        size_t i = locate(key);
+        return i != npos && entries_[i].type == type ? entries_[i].index : npos;
+    }
+
+    size_t at(size_t i, kind type) const {
+        return i < entries_.size() && entries_[i].type == type ? entries_[i].index : npos;
+    }
+
+    template <class Container>
+    static const auto& value_at(size_t i, const Container& c) {
+        static const typename Container::value_type empty{};
+        return i != npos ? c[i] : empty;
+    }
+
+    template <class Container>
+    static auto pointer_at(size_t i, const Container& c) { return i != npos ? &c[i] : nullptr; }
+
+    // A lazy object which is not parsed yet is not found
+    const basic_json* parsed_at(size_t i) const {
+        return i != npos && !objects_[i].pending_.data() ? &objects_[i] : nullptr;
+    }
+
+    void insert_index(size_t i) {
+        const size_t mask = index_.size() - 1;
+        size_t h = detail::hash_key(key_of(entries_[i])) & mask;
+        while (index_[h]) h = (h + 1) & mask;
+        index_[h] = static_cast<uint32_t>(i + 1);
+    }
+
+    void add_entry(kind type, size_t index, size_t key, uint32_t length) {
+        entries_.push_back(entry{ key, length, static_cast<uint32_t>(index), type });
+
+        const size_t n = entries_.size();
+        if (n < linear_ || list_) return;
+
+        // Keep the load factor of the index under 1/2
+        if (index_.size() < n * 2) {
+            index_.assign(index_.empty() ? linear_ * 4 : index_.size() * 2, 0);
+            for (size_t i = 0; i < n; i++) insert_index(i);
+        } else {
+            insert_index(n - 1);
+        }
+    }
+
+    // The containers keep their capacity for the next document
+    void clear() {
+        if constexpr (is_view_) keys_ = {};
+        else keys_.clear();
+        entries_.clear();
+        index_.clear();
+        values_.clear();
+        numbers_.clear();
+        arrays_.clear();
+        objects_.clear();
+        decoded_.reset();
+    }
+};
+
+//
+// Push parser for the input which arrives in chunks. A chunk may end at any
+// byte, including the middle of a key or value:
+//
+//    mjson::stream_parser p;
+//    while (size_t n = read(fd, buf, sizeof(buf))) p.feed(buf, n);
+//    mjson::json js = p.finish();
+//
+// The bytes after the end of the document are ignored.
+//
+template <class Json>
+class basic_stream_parser {
+public:
+    using allocator_type = decltype(std::declval<Json>().get_allocator());
+
+    static_assert(!Json::is_view_, "a view can not refer to the chunks of a stream");
+
+    explicit basic_stream_parser(const allocator_type& alloc = allocator_type())
+        : basic_stream_parser(options(), alloc) {}
+
+    // Only the maximum depth and the key table of the options apply to a stream
+    explicit basic_stream_parser(const options& opt, const allocator_type& alloc = allocator_type())
+        : json_(alloc), builder_(json_), fsm_(builder_), keys_(opt.keys) {
+        fsm_.set_max_depth(opt.max_depth);
+        json_.options_.keys = keys_;
+    }
+
+    basic_stream_parser(const basic_stream_parser&) = delete;
+    basic_stream_parser& operator=(const basic_stream_parser&) = delete;
+
+    // Returns false once the input is known to be invalid
+    bool feed(const char* data, size_t size) {
+        fsm_.feed(std::string_view(data, size));
+        return fsm_.state() != -1;
+    }
+
+    bool feed(std::string_view s) { return feed(s.data(), s.size()); }
+
+    // The document is complete; the following input is ignored
+    bool done() const { return fsm_.state() == -2; }
+
+    // Returns the document and resets the parser for the next one
+    Json finish() {
+        fsm_.finish();
+        json_.state_ = fsm_.state();
+        if (json_.state_ == -1) json_.clear();
+        MJSON_STAT(json_.collect_stats(fsm_, builder_, {}));
+
+        Json js(std::move(json_));
+        json_ = Json(js.get_allocator());
+        json_.options_.keys = keys_;
+        builder_.reset();
+        fsm_.reset();
+        return js;
+    }
+
+private:
+    Json json_;
+    typename Json::builder builder_;
+    detail::fsm<typename Json::builder> fsm_;
+    key_table* keys_;
+};
+
+//
+// Schema parser for documents with a layout known at compile time. Members
+// are written straight into the fields of a struct described by a schema:
+//
+//    struct update { std::string_view server; std::vector<std::string_view> auth; };
+//
+//    template <> struct mjson::schema<update> {
+//        static constexpr auto fields = std::make_tuple(
+//            mjson::field("Server", &update::server),
+//            mjson::field("Auth", &update::auth));
+//    };
+//
+//    update upd;
+//    bool ok = mjson::parse_into(msg, upd);
+//
+// Fields are std::string or std::string_view for values, std::vector of
+// them for arrays, an arithmetic type for numbers, bool, or another struct
+// with a schema for nested objects. An integral field takes only integers
+// in its range. A null member leaves the field as it is. std::string_view
+// fields refer to the input, so they keep the escapes of the raw text;
+// std::string fields get the decoded text. Keys are matched through a
+// perfect hash built at compile time; unknown members are skipped, and a
+// member of the wrong kind or a duplicate of a known key fails the parse.
+//
+template <class T>
+struct schema;
+
+template <class T, class M>
+struct field_ref {
+    std::string_view name;
+    M T::* member;
+};
+
+template <class T, class M>
+constexpr field_ref<T, M> field(std::string_view name, M T::* member) { return { name, member }; }
+
+namespace detail {
+
+struct schema_table;
+
+struct field_ops {
+    kind type;
+    void (*set)(void* obj, std::string_view value, std::string_view raw);   // a value or an array item
+    void (*clear)(void* obj);                           // an array before its items
+    void* (*child)(void* obj);                          // a nested object
+    const schema_table* table;                          // of the nested object
+    bool (*set_number)(void* obj, number value);        // false if out of range
+    void (*set_bool)(void* obj, bool value);
+};
+
+struct schema_table {
+    size_t count;
+    const std::string_view* names;
+    const unsigned char* slots;                         // field + 1; 0 is a free slot
+    size_t mask;
+    uint64_t seed;
+    const field_ops* ops;
+
+    static constexpr uint64_t hash(std::string_view key, uint64_t seed) {
+        uint64_t h = 14695981039346656037ull ^ seed;
+        for (char c : key) h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        return h ^ (h >> 29);
+    }
+
+    // Position of the field or npos
+    size_t find(std::string_view key) const {
+        const size_t i = slots[hash(key, seed) & mask];
+        return i && names[i - 1] == key ? i - 1 : static_cast<size_t>(-1);
+    }
+};
+
+// Slot table of at least count^2 entries, so a collision free seed is
+// found after a few attempts
+template <size_t N>
+struct perfect_hash {
+    static constexpr size_t size = []() {
+        size_t n = 1;
+        while (n < N * N) n *= 2;
+        return n;
+    }();
+
+    uint64_t seed{};
+    std::array<unsigned char, size> slots{};
+
+    constexpr explicit perfect_hash(const std::array<std::string_view, N>& names) {
+        for (seed = 0; ; ++seed) {
+            slots = {};
+
+            size_t i = 0;
+            for (; i < N; i++) {
+                auto& slot = slots[schema_table::hash(names[i], seed) & (size - 1)];
+                if (slot) break;
+                slot = static_cast<unsigned char>(i + 1);
+            }
+            if (i == N) return;
+        }
+    }
+};
+
+template <class M>
+struct is_vector : std::false_type {};
+
+template <class V, class A>
+struct is_vector<std::vector<V, A>> : std::true_type {};
+
+template <class M>
+constexpr kind kind_of_field() {
+    if constexpr (std::is_same_v<M, std::string> || std::is_same_v<M, std::string_view>) {
+        return kind::string;
+    } else if constexpr (is_vector<M>::value) {
+        return kind::array;
+    } else if constexpr (std::is_same_v<M, bool>) {
+        return kind::boolean;
+    } else if constexpr (std::is_arithmetic_v<M>) {
+        return kind::number;
+    } else {
+        return kind::object;
+    }
+}
+
+template <class M>
+void assign(M& m, std::string_view v, std::string_view raw) {
+    if constexpr (std::is_same_v<M, std::string_view>) m = raw;
+    else m.assign(v.data(), v.size());
+}
+
+template <class T>
+struct binding;
+
+template <class T, size_t I>
+struct accessor {
+    static auto& member(void* obj) {
+        return static_cast<T*>(obj)->*std::get<I>(schema<T>::fields).member;
+    }
+
+    using M = std::remove_reference_t<decltype(member(nullptr))>;
+
+    static void set(void* obj, std::string_view v, std::string_view raw) {
+        if constexpr (kind_of_field<M>() == kind::array) {
+            member(obj).emplace_back();
+            assign(member(obj).back(), v, raw);
+        } else {
+            assign(member(obj), v, raw);
+        }
+    }
+
+    static void clear(void* obj) { member(obj).clear(); }
+    static void* child(void* obj) { return &member(obj); }
+
+    static bool set_number(void* obj, number v) {
+        if constexpr (std::is_floating_point_v<M>) {
+            member(obj) = static_cast<M>(v.as_double());
+        } else {
+            if (!v.is_integer()) return false;
+
+            const int64_t i = v.as_int();
+            if constexpr (std::is_signed_v<M>) {
+                if (i < std::numeric_limits<M>::min() || i > std::numeric_limits<M>::max()) return false;
+            } else {
+                if (i < 0 || static_cast<uint64_t>(i) > std::numeric_limits<M>::max()) return false;
+            }
+            member(obj) = static_cast<M>(i);
+        }
+        return true;
+    }
+
+    static void set_bool(void* obj, bool v) { member(obj) = v; }
+
+    static constexpr field_ops ops() {
+        constexpr kind type = kind_of_field<M>();
+        if constexpr (type == kind::object) {
+            return { type, nullptr, nullptr, &child, &binding<M>::table, nullptr, nullptr };
+        } else if constexpr (type == kind::array) {
+            return { type, &set, &clear, nullptr, nullptr, nullptr, nullptr };
+        } else if constexpr (type == kind::number) {
+            return { type, nullptr, nullptr, nullptr, nullptr, &set_number, nullptr };
+        } else if constexpr (type == kind::boolean) {
+            return { type, nullptr, nullptr, nullptr, nullptr, nullptr, &set_bool };
+        } else {
+            return { type, &set, nullptr, nullptr, nullptr, nullptr, nullptr };
+        }
+    }
+};
+
+template <class T>
+struct binding {
+    using fields = std::remove_cv_t<decltype(schema<T>::fields)>;
+    static constexpr size_t count = std::tuple_size_v<fields>;
+
+    static_assert(count > 0 && count <= 64, "a schema has 1 to 64 fields");
+
+    template <size_t... I>
+    static constexpr std::array<std::string_view, count> make_names(std::index_sequence<I...>) {
+        return { std::get<I>(schema<T>::fields).name... };
+    }
+
+    template <size_t... I>
+    static constexpr std::array<field_ops, count> make_ops(std::index_sequence<I...>) {
+        return { accessor<T, I>::ops()... };
+    }
+
+    static constexpr std::array<std::string_view, count> names = make_names(std::make_index_sequence<count>());
+    static constexpr perfect_hash<count> hash{ names };
+    static constexpr std::array<field_ops, count> ops = make_ops(std::make_index_sequence<count>());
+
+    static constexpr schema_table table{
+        count, names.data(), hash.slots.data(), hash.size - 1, hash.seed, ops.data()
+    };
+};
+
+//
+// The state machine handler which writes into the fields. Members which are
+// not in the schema are ignored with their whole subtree, which is still
+// validated by the state machine.
+//
+class schema_handler {
+public:
+    schema_handler(void* obj, const schema_table* table) : root_{ obj, table } {}
+
+    bool on_object_begin() {
+        if (ignore_) {
+            ++ignore_;
+            return true;
+        }
+
+        if (!depth_) {
+            frames_[depth_++] = root_;
+            return true;
+        }
+
+        if (!field_) {
+            ++ignore_;
+            return true;
+        }
+
+        if (field_->type != kind::object || depth_ == max_depth_) return false;
+
+        void* obj = field_->child(frames_[depth_ - 1].obj);
+        frames_[depth_++] = frame{ obj, field_->table };
+        return true;
+    }
+
+    bool on_object_end() {
+        if (ignore_) --ignore_;
+        else --depth_;
+        return true;
+    }
+
+    bool on_key(std::string_view key, std::string_view) {
+        if (ignore_) return true;
+
+        frame& top = frames_[depth_ - 1];
+        const size_t i = top.table->find(key);
+        if (i == static_cast<size_t>(-1)) {
+            field_ = nullptr;
+            return true;
+        }
+
+        if (top.seen & (uint64_t(1) << i)) return false;
+        top.seen |= uint64_t(1) << i;
+
+        field_ = &top.table->ops[i];
+        return true;
+    }
+
+    bool on_string(std::string_view value, std::string_view raw) {
+        if (ignore_ || !field_) return true;
+        if (field_->type != (arrays_ ? kind::array : kind::string)) return false;
+
+        field_->set(frames_[depth_ - 1].obj, value, raw);
+        return true;
+    }
+
+    bool on_number(number value) {
+        if (ignore_ || !field_) return true;
+        if (arrays_ || field_->type != kind::number) return false;
+
+        return field_->set_number(frames_[depth_ - 1].obj, value);
+    }
+
+    bool on_bool(bool value) {
+        if (ignore_ || !field_) return true;
+        if (arrays_ || field_->type != kind::boolean) return false;
+
+        field_->set_bool(frames_[depth_ - 1].obj, value);
+        return true;
+    }
+
+    bool on_null() { return ignore_ || !field_ || !arrays_; }
+
+    // Arrays of an array field can not be nested
+    bool on_array_begin() {
+        if (arrays_++ && !ignore_ && field_) return false;
+        if (ignore_ || !field_) return true;
+        if (field_->type != kind::array) return false;
+
+        field_->clear(frames_[depth_ - 1].obj);
+        return true;
+    }
+
+    bool on_array_end() {
+        --arrays_;
+        return true;
+    }
+
+private:
+    struct frame {
+        void* obj;
+        const schema_table* table;
+        uint64_t seen{};
+    };
+
+    static constexpr size_t max_depth_ = 32;
+
+    frame root_;
+    std::array<frame, max_depth_> frames_{};
+    size_t depth_{};
+
+    const field_ops* field_{};
+    size_t ignore_{};
+    size_t arrays_{};
+};
+
+} // namespace detail
+
+// Parses the document into the struct; returns false if it is not valid json
+// or does not match the schema. The fields which are not in the document keep
+// their values.
+template <class T>
+bool parse_into(std::string_view s, T& out) {
+    detail::schema_handler h(&out, &detail::binding<T>::table);
+    detail::fsm<detail::schema_handler> fsm(h);
+    fsm.feed(s);
+    fsm.finish();
+    return fsm.state() == -2;
+}
+
+//
+// Reader of concatenated or newline-delimited documents, e.g. NDJSON logs,
+// from one buffer or a mapped file. The document and the parser are reused
+// for every record, so the containers keep their capacity:
+//
+//    mjson::document_stream docs(log);
+//    for (mjson::json& js : docs)
+//        if (js.is_valid()) handle(js);
+//
+// An invalid record is returned as an invalid document and the reader goes
+// on from the next line. A view refers to the buffer, which must outlive it.
+//
+template <class Json>
+class basic_document_stream {
+public:
+    using allocator_type = decltype(std::declval<Json>().get_allocator());
+
+    explicit basic_document_stream(std::string_view s, const allocator_type& alloc = allocator_type())
+        : s_(s), parser_(std::make_unique<parser>(alloc)) {}
+
+    // A missing file reads as an empty stream
+    static basic_document_stream from_file(const std::string& path,
+                                           const allocator_type& alloc = allocator_type()) {
+        auto file = std::make_shared<const mapped_file>(path);
+        basic_document_stream ds(file->view(), alloc);
+        ds.file_ = file;
+        return ds;
+    }
+
+    // Parses the next record into document(); returns false at the end
+    bool next() {
+        parser& p = *parser_;
+        p.json.clear();
+        p.json.state_ = 0;
+        p.builder.reset();
+        p.fsm.reset();
+
+        const char* const b = s_.data();
+        pos_ = detail::active_scanner().whitespace_end(b + pos_, b + s_.length()) - b;
+        if (pos_ == s_.length()) return false;
+
+        std::string_view rest = s_.substr(pos_);
+        if constexpr (Json::is_view_) {
+            p.json.keys_ = rest;
+            p.json.owner_ = file_;
+        }
+
+        const size_t n = p.fsm.feed(rest);
+        p.fsm.finish();
+        p.json.state_ = p.fsm.state();
+        MJSON_STAT(p.json.collect_stats(p.fsm, p.builder, rest.substr(0, n)));
+
+        offset_ = pos_;
+        if (p.json.state_ == -2) {
+            pos_ += n;
+            return true;
+        }
+
+        // Resynchronize on the next line
+        p.json.clear();
+        const size_t eol = s_.find('\n', pos_ + n);
+        pos_ = eol == std::string_view::npos ? s_.length() : eol + 1;
+        return true;
+    }
+
+    Json& document() { return parser_->json; }
+
+    // Position of the current record in the buffer
+    size_t offset() const { return offset_; }
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Json;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Json*;
+        using reference = Json&;
+
+        explicit iterator(basic_document_stream* ds = nullptr) : ds_(ds) { if (ds_ && !ds_->next()) ds_ = nullptr; }
+
+        Json& operator*() const { return ds_->document(); }
+        Json* operator->() const { return &ds_->document(); }
+
+        iterator& operator++() {
+            if (!ds_->next()) ds_ = nullptr;
+            return *this;
+        }
+
+        bool operator==(const iterator& it) const { return ds_ == it.ds_; }
+        bool operator!=(const iterator& it) const { return ds_ != it.ds_; }
+
+    private:
+        basic_document_stream* ds_;
+    };
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+
+private:
+    // Kept on the heap: the state machine refers to the builder and the
+    // builder to the document
+    struct parser {
+        explicit parser(const allocator_type& alloc) : json(alloc), builder(json), fsm(builder) {}
+
+        Json json;
+        typename Json::builder builder;
+        detail::fsm<typename Json::builder> fsm;
+    };
+
+    std::string_view s_;
+    size_t pos_{};
+    size_t offset_{};
+
+    std::unique_ptr<parser> parser_;
+    std::shared_ptr<const mapped_file> file_{};
+};
+
+//
+// Splits concatenated or newline-delimited documents at the top-level record
+// boundaries by matching braces, so the records can be parsed in parallel
+// with parse_batch. A record which can not be matched ends at its line end.
+//
+inline std::vector<std::string_view> split_documents(std::string_view s) {
+    std::vector<std::string_view> docs;
+
+    const char* const b = s.data();
+    const char* const e = b + s.length();
+    const char* p = detail::active_scanner().whitespace_end(b, e);
+
+    while (p < e) {
+        const char* end = *p == '{' ? detail::match_braces(p, e) : nullptr;
+        if (end == e) {
+            docs.emplace_back(p, e - p);
+            break;
+        }
+
+        if (!end) {
+            end = static_cast<const char*>(std::memchr(p, '\n', e - p));
+            if (!end) end = e - 1;
+        }
+
+        docs.emplace_back(p, end + 1 - p);
+        p = detail::active_scanner().whitespace_end(end + 1, e);
+    }
+
+    return docs;
+}
+
+//
+// Serializer into a caller-provided growable buffer, either of a whole
+// document or of streamed calls:
+//
+//    std::string out;
+//    mjson::writer w(out, mjson::writer::pretty);
+//    w.begin_object().key("Device").value("HeartMN1")
+//     .key("Image").begin_array().value("PBS-09").end_array()
+//     .end_object();
+//
+// A document is measured first, so the buffer grows only once. Quotes,
+// backslashes and control chars are escaped; runs of other chars are copied
+// in bulk. Numbers, booleans and null are written with value() and null().
+//
+template <class Buffer = std::string>
+class basic_writer {
+public:
+    enum mode { compact, pretty };
+
+    explicit basic_writer(Buffer& out, mode m = compact, unsigned indent = 4)
+        : out_(out), pretty_(m == pretty), indent_(indent) {}
+
+    basic_writer& begin_object() { open('{'); return *this; }
+    basic_writer& end_object() { close('}'); return *this; }
+    basic_writer& begin_array() { open('['); return *this; }
+    basic_writer& end_array() { close(']'); return *this; }
+
+    basic_writer& key(std::string_view k) {
+        separate();
+        string(k);
+        out_.append(pretty_ ? ": " : ":");
+        after_key_ = true;
+        return *this;
+    }
+
+    basic_writer& value(std::string_view v) {
+        separate();
+        string(v);
+        return *this;
+    }
+
+    basic_writer& value(const char* v) { return value(std::string_view(v)); }
+
+    // Numbers are written in the shortest form which reads back the same;
+    // an infinity or a NaN, which json has no form for, as null
+    basic_writer& value(number v) {
+        separate();
+        char buf[32];
+        out_.append(buf, format(v, buf));
+        return *this;
+    }
+
+    template <class T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+    basic_writer& value(T v) {
+        if constexpr (std::is_same_v<T, bool>) {
+            separate();
+            out_.append(v ? "true" : "false");
+            return *this;
+        } else if constexpr (std::is_unsigned_v<T>) {
+            // Unsigned values above INT64_MAX have no number form
+            separate();
+            char buf[24];
+            out_.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr - buf);
+            return *this;
+        } else if constexpr (std::is_integral_v<T>) {
+            return value(number(static_cast<int64_t>(v)));
+        } else {
+            return value(number(static_cast<double>(v)));
+        }
+    }
+
+    basic_writer& null() {
+        separate();
+        out_.append("null");
+        return *this;
+    }
+
+    // Writes a whole document as a value
+    template <class Json>
+    basic_writer& write(Json& js) {
+        out_.reserve(out_.size() + measure(js, pretty_ ? pretty : compact, indent_, depth_) +
+                     (pretty_ ? 1 + depth_ * indent_ : 0) + 1);
+        container(js, false);
+        return *this;
+    }
+
+    // Exact size of the document written at the given depth
+    template <class Json>
+    static size_t measure(Json& js, mode m = compact, unsigned indent = 4, size_t depth = 0) {
+        return container_size(js, false, m == pretty, indent, depth);
+    }
+
+private:
+    Buffer& out_;
+    bool pretty_;
+    unsigned indent_;
+
+    size_t depth_{};
+    bool first_{ true };
+    bool after_key_{};
+
+    // An object, or a list whose members have no keys
+    template <class Json>
+    void container(Json& js, bool list) {
+        list ? begin_array() : begin_object();
+        for (size_t i = 0; i < js.size(); i++) {
+            if (!list) key(js.key(i));
+
+            switch (js.kind_of(i)) {
+            case kind::string:
+                value(js.get(i));
+                break;
+            case kind::array:
+                begin_array();
+                for (auto& v : js.get_array(i)) value(v);
+                end_array();
+                break;
+            case kind::object:
+                container(js.get_object(i), false);
+                break;
+            case kind::number:
+                value(js.get_number(i));
+                break;
+            case kind::boolean:
+                value(js.get_bool(i));
+                break;
+            case kind::null:
+                null();
+                break;
+            case kind::list:
+                container(js.get_list(i), true);
+                break;
+            }
+        }
+        list ? end_array() : end_object();
+    }
+
+    template <class Json>
+    static size_t container_size(Json& js, bool list, bool p, unsigned indent, size_t depth) {
+        const size_t n = js.size();
+
+        size_t size = 2;
+        for (size_t i = 0; i < n; i++) {
+            size += (i ? 1 : 0) + (p ? 1 + (depth + 1) * indent : 0);
+            if (!list) size += quoted_size(js.key(i)) + (p ? 2 : 1);
+
+            switch (js.kind_of(i)) {
+            case kind::string:
+                size += quoted_size(js.get(i));
+                break;
+            case kind::array: {
+                auto& arr = js.get_array(i);
+                size += 2;
+                for (size_t j = 0; j < arr.size(); j++)
+                    size += (j ? 1 : 0) + (p ? 1 + (depth + 2) * indent : 0) + quoted_size(arr[j]);
+                if (p && !arr.empty()) size += 1 + (depth + 1) * indent;
+                break;
+            }
+            case kind::object:
+                size += container_size(js.get_object(i), false, p, indent, depth + 1);
+                break;
+            case kind::number: {
+                char buf[32];
+                size += format(js.get_number(i), buf);
+                break;
+            }
+            case kind::boolean:
+                size += js.get_bool(i) ? 4 : 5;
+                break;
+            case kind::null:
+                size += 4;
+                break;
+            case kind::list:
+                size += container_size(js.get_list(i), true, p, indent, depth + 1);
+                break;
+            }
+        }
+        if (p && n) size += 1 + depth * indent;
+
+        return size;
+    }
+
+    // Length of the number written into 'buf'
+    static size_t format(number v, char* buf) {
+        const double d = v.as_double();
+        if (!v.is_integer() && (d != d || d - d != 0)) {
+            std::memcpy(buf, "null", 4);
+            return 4;
+        }
+
+        if (v.is_integer()) return std::to_chars(buf, buf + 32, v.as_int()).ptr - buf;
+
+        // A whole double keeps a fraction, so it reads back as a double
+        char* e = detail::write_double(buf, d);
+        if (std::find_if(buf, e, [](char c) { return c == '.' || c == 'e'; }) == e) {
+            *e++ = '.';
+            *e++ = '0';
+        }
+        return e - buf;
+    }
+
+    void newline(size_t depth) {
+        out_.push_back('\n');
+        out_.append(depth * indent_, ' ');
+    }
+
+    // A comma and the indentation before a member or an item
+    void separate() {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+
+        if (!first_) out_.push_back(',');
+        if (pretty_ && depth_) newline(depth_);
+        first_ = false;
+    }
+
+    void open(char c) {
+        separate();
+        out_.push_back(c);
+        ++depth_;
+        first_ = true;
+    }
+
+    void close(char c) {
+        --depth_;
+        if (pretty_ && !first_) newline(depth_);
+        out_.push_back(c);
+        first_ = false;
+    }
+
+    // Short escape char, 'u' for \u00XX, or 0 if the char is copied as is
+    static constexpr std::array<char, 256> escape_ = []() {
+        std::array<char, 256> esc{};
+        for (int c = 0; c < 0x20; c++) esc[c] = 'u';
+        esc['"'] = '"';
+        esc['\\'] = '\\';
+        esc['\b'] = 'b';
+        esc['\f'] = 'f';
+        esc['\n'] = 'n';
+        esc['\r'] = 'r';
+        esc['\t'] = 't';
+        return esc;
+    }();
+
+    // The first char which has to be escaped or 'e'; eight chars are
+    // tested at once for a quote, a backslash or a control char
+    static const char* plain_end(const char* p, const char* e) {
+        constexpr uint64_t ones = 0x0101010101010101ull, highs = 0x8080808080808080ull;
+
+        for (; e - p >= 8; p += 8) {
+            uint64_t v;
+            std::memcpy(&v, p, 8);
+
+            const uint64_t q = v ^ (ones * '"'), b = v ^ (ones * '\\');
+            const uint64_t m = ((q - ones) & ~q) | ((b - ones) & ~b) | ((v - ones * 0x20) & ~v);
+            if (m & highs) break;
+        }
+
+        while (p < e && !escape_[detail::uchar(*p)]) ++p;
+        return p;
+    }
+
+    static size_t quoted_size(std::string_view s) {
+        size_t size = s.size() + 2;
+
+        const char* const e = s.data() + s.size();
+        for (const char* p = plain_end(s.data(), e); p < e; p = plain_end(p + 1, e))
+            size += escape_[detail::uchar(*p)] == 'u' ? 5 : 1;
+        return size;
+    }
+
+    void string(std::string_view s) {
+        static constexpr char hex[] = "0123456789abcdef";
+
+        out_.push_back('"');
+
+        const char* const e = s.data() + s.size();
+        const char* run = s.data();
+        for (const char* p = plain_end(run, e); p < e; p = plain_end(run, e)) {
+            out_.append(run, p - run);
+            run = p + 1;
+
+            const char c = escape_[detail::uchar(*p)];
+            const char esc[] = { '\\', c, '0', '0', hex[detail::uchar(*p) >> 4], hex[*p & 0xf] };
+            out_.append(esc, c == 'u' ? 6 : 2);
+        }
+        out_.append(run, e - run);
+        out_.push_back('"');
+    }
+};
+
+using writer = basic_writer<>;
+
+// Serializes the document into a string of the exact size. Lazy objects of a
+// non-const document are parsed on the way; a const document writes the ones
+// not parsed yet as empty objects.
+template <class Json>
+std::string to_string(Json& js, writer::mode m = writer::compact, unsigned indent = 4) {
+    std::string out;
+    writer(out, m, indent).write(js);
+    return out;
+}
+
+//
+// Binary form of a parsed document, which is read in place, e.g. straight
+// from a mapped file, with no parse step. All the fields are 32-bit words in
+// the byte order of the machine which wrote them; offsets are from the start
+// of the buffer, so the buffer is limited to 4 GB:
+//
+//    header  : magic, version, size of the buffer, offset of the root
+//    object  : count, slots, count entries, slots words of the hash index
+//    entry   : kind | 0x100 for an integer, key offset, key length, a, b
+//    array   : count pairs of offset and length of the items
+//
+// The a and b words of an entry are the offset and length of a string, the
+// offset and count of an array, the offset of an object or a list, the low
+// and high halves of a number, or the value of a boolean. Objects with more
+// than 8 members have an index of entry + 1 by the hash of the key, 0 being
+// a free slot, like a parsed document.
+//
+namespace detail {
+
+struct binary_format {
+    static constexpr uint32_t magic = 0x62736a6d;   // "mjsb"
+    static constexpr uint32_t version = 1;
+    static constexpr size_t header_size = 16;
+    static constexpr size_t entry_size = 20;
+    static constexpr size_t linear = 8;
+
+    // Every offset and length fits into a word
+    static constexpr size_t max_size = UINT32_MAX;
+};
+
+template <class Json>
+class binary_writer {
+public:
+    explicit binary_writer(std::string& out, size_t limit = binary_format::max_size)
+        : out_(out), limit_(limit) {}
+
+    // Offsets are from the start of out_, which is empty. A document which
+    // does not fit into the limit is not written; out_ is left empty.
+    bool write(Json& js) {
+        out_.resize(binary_format::header_size);
+        const size_t root = container(js, false);
+        if (out_.size() > limit_) {
+            out_.clear();
+            return false;
+        }
+
+        put(0, binary_format::magic);
+        put(4, binary_format::version);
+        put(8, static_cast<uint32_t>(out_.size()));
+        put(12, static_cast<uint32_t>(root));
+        return true;
+    }
+
+private:
+    std::string& out_;
+    size_t limit_;
+
+    void put(size_t at, uint32_t v) { std::memcpy(&out_[at], &v, 4); }
+
+    uint32_t append(std::string_view s) {
+        const size_t at = out_.size();
+        out_.append(s.data(), s.size());
+        return static_cast<uint32_t>(at);
+    }
+
+    static size_t slots_for(size_t n) {
+        if (n <= binary_format::linear) return 0;
+        size_t slots = 32;
+        while (slots < n * 2) slots *= 2;
+        return slots;
+    }
+
+    size_t container(Json& js, bool list) {
+        const size_t n = js.size();
+        const size_t slots = list ? 0 : slots_for(n);
+        const size_t at = out_.size();
+        out_.resize(at + 8 + n * binary_format::entry_size + slots * 4);
+        put(at, static_cast<uint32_t>(n));
+        put(at + 4, static_cast<uint32_t>(slots));
+
+        // The words written past the limit are dropped with the output
+        for (size_t i = 0; i < n && out_.size() <= limit_; i++) {
+            uint32_t w[5] = { static_cast<uint32_t>(js.kind_of(i)), 0, 0, 0, 0 };
+            if (!list) {
+                const std::string_view k = js.key(i);
+                w[1] = append(k);
+                w[2] = static_cast<uint32_t>(k.size());
+            }
+
+            switch (js.kind_of(i)) {
+            case kind::string: {
+                const std::string_view v = js.get(i);
+                w[3] = append(v);
+                w[4] = static_cast<uint32_t>(v.size());
+                break;
+            }
+            case kind::array: {
+                const auto& arr = js.get_array(i);
+                const size_t a = out_.size();
+                out_.resize(a + arr.size() * 8);
+                for (size_t j = 0; j < arr.size(); j++) {
+                    const std::string_view v = arr[j];
+                    put(a + j * 8, append(v));
+                    put(a + j * 8 + 4, static_cast<uint32_t>(v.size()));
+                }
+                w[3] = static_cast<uint32_t>(a);
+                w[4] = static_cast<uint32_t>(arr.size());
+                break;
+            }
+            case kind::object:
+                w[3] = static_cast<uint32_t>(container(js.get_object(i), false));
+                break;
+            case kind::list:
+                w[3] = static_cast<uint32_t>(container(js.get_list(i), true));
+                break;
+            case kind::number: {
+                const number v = js.get_number(i);
+                uint64_t bits;
+                if (v.is_integer()) {
+                    const int64_t x = v.as_int();
+                    std::memcpy(&bits, &x, 8);
+                    w[0] |= 0x100;
+                } else {
+                    const double x = v.as_double();
+                    std::memcpy(&bits, &x, 8);
+                }
+                w[3] = static_cast<uint32_t>(bits);
+                w[4] = static_cast<uint32_t>(bits >> 32);
+                break;
+            }
+            case kind::boolean:
+                w[3] = js.get_bool(i);
+                break;
+            case kind::null:
+                break;
+            }
+
+            std::memcpy(&out_[at + 8 + i * binary_format::entry_size], w, sizeof(w));
+        }
+
+        for (size_t i = 0; i < n && slots; i++) {
+            const size_t mask = slots - 1;
+            size_t h = hash_key(js.key(i)) & mask;
+            while (word(at + 8 + n * binary_format::entry_size + h * 4)) h = (h + 1) & mask;
+            put(at + 8 + n * binary_format::entry_size + h * 4, static_cast<uint32_t>(i + 1));
+        }
+        return at;
+    }
+
+    uint32_t word(size_t at) const {
+        uint32_t v;
+        std::memcpy(&v, &out_[at], 4);
+        return v;
+    }
+};
+
+// Bytes of the binary form; a read out of them gives 0 or an empty string
+struct binary_buffer {
+    const char* data{};
+    size_t size{};
+
+    bool fits(size_t at, size_t n) const { return at <= size && n <= size - at; }
+
+    uint32_t word(size_t at) const {
+        uint32_t v = 0;
+        if (fits(at, 4)) std::memcpy(&v, data + at, 4);
+        return v;
+    }
+
+    std::string_view string(size_t at, size_t n) const {
+        return fits(at, n) ? std::string_view(data + at, n) : std::string_view();
+    }
+};
+
+} // namespace detail
+
+//
+// Read-only document over the binary form with the lookups of a parsed
+// document. Nothing is decoded up front: every access reads the words it
+// needs, so only the touched pages of a mapped file are loaded. Offsets are
+// checked against the buffer, so damaged data reads as missing members
+// rather than out of bounds.
+//
+class binary_view {
+public:
+    // Items of an array of strings; the array keeps the buffer like an
+    // object of the view does
+    class array {
+    public:
+        size_t size() const { return count_; }
+        bool empty() const { return !count_; }
+
+        std::string_view operator[](size_t i) const {
+            return buf_.string(buf_.word(at_ + i * 8), buf_.word(at_ + i * 8 + 4));
+        }
+        std::string_view at(size_t i) const { return i < count_ ? (*this)[i] : std::string_view(); }
+
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const std::string_view*;
+            using reference = std::string_view;
+
+            iterator(const array* a, size_t i) : a_(a), i_(i) {}
+
+            std::string_view operator*() const { return (*a_)[i_]; }
+            iterator& operator++() {
+                ++i_;
+                return *this;
+            }
+
+            bool operator==(const iterator& it) const { return i_ == it.i_; }
+            bool operator!=(const iterator& it) const { return i_ != it.i_; }
+
+        private:
+            const array* a_;
+            size_t i_;
+        };
+
+        iterator begin() const { return iterator(this, 0); }
+        iterator end() const { return iterator(this, count_); }
+
+    private:
+        friend class binary_view;
+
+        array() = default;
+        array(const binary_view& doc, size_t at, size_t count)
+            : owner_(doc.owner_), buf_(doc.buf_), at_(at), count_(count) {}
+
+        std::shared_ptr<const void> owner_{};
+        detail::binary_buffer buf_{};
+        size_t at_{};
+        size_t count_{};
+    };
+
+    binary_view() = default;
+
+    // The caller keeps the buffer alive while the view is used
+    explicit binary_view(std::string_view data) { open(data); }
+
+    // Takes ownership of the buffer
+    explicit binary_view(std::string&& data) {
+        auto owner = std::make_shared<const std::string>(std::move(data));
+        owner_ = owner;
+        open(*owner);
+    }
+
+    // Maps the file, which is kept mapped while the view or any of its
+    // objects is alive. A missing file gives an invalid view.
+    static binary_view from_file(const std::string& path) {
+        auto file = std::make_shared<const mapped_file>(path);
+        binary_view v(file->view());
+        v.owner_ = file;
+        return v;
+    }
+
+    // The buffer has the header of the binary form
+    bool is_valid() const { return valid_; }
+
+    size_t size() const { return count_; }
+    std::string_view key(size_t i) const { return string(field(i, 1), field(i, 2)); }
+    kind kind_of(size_t i) const { return static_cast<kind>(field(i, 0) & 0xff); }
+
+    std::string_view operator[] (key_ref key) const { return get(key); }
+
+    bool has(key_ref key) const { return locate(key, kind::string) != npos; }
+    std::string_view get(key_ref key) const { return get(locate(key, kind::string)); }
+
+    bool has_array(key_ref key) const { return locate(key, kind::array) != npos; }
+    array get_array(key_ref key) const { return get_array(locate(key, kind::array)); }
+
+    bool has_object(key_ref key) const { return locate(key, kind::object) != npos; }
+    binary_view get_object(key_ref key) const { return get_object(locate(key, kind::object)); }
+
+    bool has_number(key_ref key) const { return locate(key, kind::number) != npos; }
+    number get_number(key_ref key) const { return get_number(locate(key, kind::number)); }
+    int64_t get_int(key_ref key) const { return get_number(key).as_int(); }
+    double get_double(key_ref key) const { return get_number(key).as_double(); }
+
+    bool has_bool(key_ref key) const { return locate(key, kind::boolean) != npos; }
+    bool get_bool(key_ref key) const { return get_bool(locate(key, kind::boolean)); }
+
+    bool is_null(key_ref key) const { return locate(key, kind::null) != npos; }
+
+    bool has_list(key_ref key) const { return locate(key, kind::list) != npos; }
+    binary_view get_list(key_ref key) const { return get_list(locate(key, kind::list)); }
+
+    // Members by position, 0 <= i < size(); a member of another kind reads
+    // as an empty value
+    std::string_view get(size_t i) const { return is(i, kind::string) ? string(field(i, 3), field(i, 4)) : std::string_view(); }
+    array get_array(size_t i) const { return is(i, kind::array) ? items(field(i, 3), field(i, 4)) : array(); }
+    binary_view get_object(size_t i) const { return is(i, kind::object) ? child(field(i, 3)) : binary_view(); }
+    binary_view get_list(size_t i) const { return is(i, kind::list) ? child(field(i, 3)) : binary_view(); }
+    bool get_bool(size_t i) const { return is(i, kind::boolean) && field(i, 3); }
+
+    number get_number(size_t i) const {
+        if (!is(i, kind::number)) return number();
+
+        const uint64_t bits = field(i, 3) | (uint64_t(field(i, 4)) << 32);
+        if (field(i, 0) & 0x100) {
+            int64_t x;
+            std::memcpy(&x, &bits, 8);
+            return number(x);
+        }
+        double x;
+        std::memcpy(&x, &bits, 8);
+        return number(x);
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    std::shared_ptr<const void> owner_{};
+    detail::binary_buffer buf_{};
+    bool valid_{};
+
+    // The object of this view
+    size_t at_{};
+    size_t count_{};
+    size_t slots_{};
+
+    void open(std::string_view data) {
+        using f = detail::binary_format;
+
+        buf_ = { data.data(), data.size() };
+        valid_ = buf_.size >= f::header_size && word(0) == f::magic && word(4) == f::version &&
+                 word(8) <= buf_.size;
+        if (!valid_) {
+            buf_.size = 0;
+            return;
+        }
+
+        buf_.size = word(8);
+        object(word(12));
+    }
+
+    // A record which does not fit into the buffer is an empty object
+    void object(size_t at) {
+        at_ = at;
+        count_ = word(at);
+        slots_ = word(at + 4);
+        if (slots_ & (slots_ - 1) || !fits(at + 8, count_ * detail::binary_format::entry_size + slots_ * 4)) {
+            count_ = 0;
+            slots_ = 0;
+        }
+    }
+
+    bool fits(size_t at, size_t n) const { return buf_.fits(at, n); }
+    uint32_t word(size_t at) const { return buf_.word(at); }
+    std::string_view string(size_t at, size_t n) const { return buf_.string(at, n); }
+
+    uint32_t field(size_t i, size_t f) const {
+        return i < count_ ? word(at_ + 8 + i * detail::binary_format::entry_size + f * 4) : 0;
+    }
+
+    bool is(size_t i, kind type) const { return i < count_ && kind_of(i) == type; }
+
+    array items(size_t at, size_t count) const {
+        return fits(at, count * 8) ? array(*this, at, count) : array();
+    }
+
+    binary_view child(size_t at) const {
+        binary_view v;
+        v.owner_ = owner_;
+        v.buf_ = buf_;
+        v.valid_ = valid_;
+        v.object(at);
+        return v;
+    }
+
+    size_t locate(const key_ref& key, kind type) const {
+        const std::string_view name = key.name();
+        size_t i = npos;
+        if (!slots_) {
+            for (size_t j = 0; j < count_ && i == npos; j++)
+                if (this->key(j) == name) i = j;
+        } else {
+            const size_t mask = slots_ - 1;
+            const size_t index = at_ + 8 + count_ * detail::binary_format::entry_size;
+            for (size_t h = key.hash() & mask, n = 0; n < slots_; h = (h + 1) & mask, n++) {
+                const size_t e = word(index + h * 4);
+                if (!e) break;
+                if (e <= count_ && this->key(e - 1) == name) {
+                    i = e - 1;
+                    break;
+                }
+            }
+        }
+        return i != npos && kind_of(i) == type ? i : npos;
+    }
+};
+
+// Writes the binary form of the document, which is read back in place by
+// load_binary(). Lazy objects are parsed on the way, as by to_string(). A
+// document whose binary form is over 4 GB gives an empty string, which loads
+// as an invalid view.
+template <class Json>
+std::string save_binary(Json& js) {
+    std::string out;
+    detail::binary_writer<Json>(out).write(js);
+    return out;
+}
+
+// The caller keeps the buffer alive while the view is used
+inline binary_view load_binary(std::string_view data) { return binary_view(data); }
+inline binary_view load_binary(std::string&& data) { return binary_view(std::move(data)); }
+
+//
+// Parser for many documents in a row, e.g. the messages of a connection. The
+// nested objects, arrays and strings of the previous document are kept with
+// their capacity and reused for the next one:
+//
+//    mjson::parser p;
+//    mjson::json js;
+//    while (receive(msg))
+//        if (p.parse(msg, js)) handle(js);
+//
+// The documents should use the allocator of the parser.
+//
+template <class Json>
+class basic_parser {
+public:
+    using allocator_type = decltype(std::declval<Json>().get_allocator());
+
+    explicit basic_parser(const allocator_type& alloc = allocator_type())
+        : basic_parser(options(), alloc) {}
+
+    // Only the maximum depth and the key table of the options apply to a parser
+    explicit basic_parser(const options& opt, const allocator_type& alloc = allocator_type())
+        : scratch_(alloc), builder_(scratch_, &spare_), fsm_(builder_), keys_(opt.keys) {
+        fsm_.set_max_depth(opt.max_depth);
+    }
+
+    basic_parser(const basic_parser&) = delete;
+    basic_parser& operator=(const basic_parser&) = delete;
+
+    // Replaces the content of 'out'; returns out.is_valid()
+    bool parse(std::string_view s, Json& out) {
+        out.recycle(spare_);
+        out.options_.keys = keys_;
+        if constexpr (Json::is_view_) out.keys_ = s;
+
+        builder_.rebind(out);
+        builder_.reset();
+        fsm_.reset();
+        fsm_.feed(s);
+        fsm_.finish();
+
+        out.state_ = fsm_.state();
+        if (out.state_ == -1) {
+            out.recycle(spare_);
+            out.state_ = -1;
+        }
+        MJSON_STAT(out.collect_stats(fsm_, builder_, s));
+        return out.state_ == -2;
+    }
+
+private:
+    typename Json::pool spare_{};
+    Json scratch_;
+    typename Json::builder builder_;
+    detail::fsm<typename Json::builder> fsm_;
+    key_table* keys_;
+};
+
+//
+// The current version of a document which is reloaded at runtime while many
+// threads read it. A reload parses the new version aside and publishes it
+// with one atomic store; a version is never changed once published, and is
+// released when the last reader lets it go:
+//
+//    mjson::config_snapshot cfg(text);
+//
+//    // in a worker thread
+//    mjson::config_snapshot::reader r(cfg);
+//    while (receive(msg)) route(msg, r->get("Server"));
+//
+//    // in the reloading thread
+//    cfg.reload(read_file(path));
+//
+// A reader keeps the version it has seen and only checks the version counter
+// on every access, which is a single atomic load; it takes the new version
+// at the first access after a reload. The lazy option does not apply: a
+// published document has no lazy objects left to parse.
+//
+template <class Json>
+class basic_config_snapshot {
+public:
+    using pointer = std::shared_ptr<const Json>;
+
+    explicit basic_config_snapshot(const options& opt = options())
+        : options_{ false, opt.max_depth, opt.keys }, current_(std::make_shared<const Json>()) {}
+
+    explicit basic_config_snapshot(std::string s, const options& opt = options())
+        : basic_config_snapshot(opt) {
+        reload(std::move(s));
+    }
+
+    basic_config_snapshot(const basic_config_snapshot&) = delete;
+    basic_config_snapshot& operator=(const basic_config_snapshot&) = delete;
+
+    // An invalid document is not published; the current version stays
+    bool reload(std::string s) {
+        auto js = std::make_shared<const Json>(std::move(s), options_);
+        if (!js->is_valid()) return false;
+
+        publish(std::move(js));
+        return true;
+    }
+
+    bool reload_file(const std::string& path) {
+        auto js = std::make_shared<const Json>(Json::from_file(path, options_));
+        if (!js->is_valid()) return false;
+
+        publish(std::move(js));
+        return true;
+    }
+
+    void publish(pointer js) {
+#ifdef __cpp_lib_atomic_shared_ptr
+        current_.store(std::move(js), std::memory_order_release);
+#else
+        std::atomic_store_explicit(&current_, std::move(js), std::memory_order_release);
+#endif
+        version_.fetch_add(1, std::memory_order_release);
+    }
+
+    // The current version; an empty document until the first one is published
+    pointer load() const {
+#ifdef __cpp_lib_atomic_shared_ptr
+        return current_.load(std::memory_order_acquire);
+#else
+        return std::atomic_load_explicit(&current_, std::memory_order_acquire);
+#endif
+    }
+
+    // Number of the versions published so far
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+    // Access of one thread; the reader must not outlive the snapshot
+    class reader {
+    public:
+        explicit reader(const basic_config_snapshot& s) : s_(&s) {}
+
+        const Json& get() {
+            const uint64_t v = s_->version();
+            if (!js_ || v != version_) {
+                // A reload between the two loads is taken at the next access
+                js_ = s_->load();
+                version_ = v;
+            }
+            return *js_;
+        }
+
+        const Json& operator*() { return get(); }
+        const Json* operator->() { return &get(); }
+
+        // Lets the version go until the next access
+        void release() { js_.reset(); }
+
+    private:
+        const basic_config_snapshot* s_;
+        pointer js_{};
+        uint64_t version_{};
+    };
+
+private:
+    options options_;
+#ifdef __cpp_lib_atomic_shared_ptr
+    std::atomic<pointer> current_;
+#else
+    pointer current_;
+#endif
+    std::atomic<uint64_t> version_{ 0 };
+};
+
+//
+// Event interface for the documents which are filtered or forwarded without
+// building a tree. The handler is a template parameter, so the events are
+// inlined. Derive from sax_handler and hide the events of interest; payloads
+// are slices of the input, except the keys and strings with escapes, which
+// are decoded into a buffer valid during the event. An event returns false
+// to stop the parse:
+//
+//    struct router : mjson::sax_handler {
+//        bool next = false;
+//        std::string_view route;
+//
+//        bool on_key(std::string_view key) { next = key == "Route"; return true; }
+//        bool on_string(std::string_view value) {
+//            if (next) route = value;
+//            return !next;
+//        }
+//    };
+//
+//    router r;
+//    mjson::sax_parse(msg, r);
+//
+// A handler may also have skip_object() and on_object_skipped(raw) to skip
+// nested objects by matching their braces. Duplicate keys are not detected.
+//
+struct sax_handler {
+    bool on_object_begin() { return true; }
+    bool on_object_end() { return true; }
+    bool on_key(std::string_view) { return true; }
+    bool on_string(std::string_view) { return true; }   // a value or an array item
+    bool on_number(number) { return true; }
+    bool on_bool(bool) { return true; }
+    bool on_null() { return true; }
+    bool on_array_begin() { return true; }
+    bool on_array_end() { return true; }
+};
+
+struct sax_result {
+    bool valid;         // the whole document has been parsed
+    bool stopped;       // the handler has stopped the parse
+    size_t offset;      // where the parse has ended: past the document or the
+                        // token the handler stopped on, or at the error
+
+    explicit operator bool() const { return valid; }
+};
+
+namespace detail {
+
+// Tells the handler's stop from a syntax error
+template <class Handler>
+class sax_adapter {
+public:
+    explicit sax_adapter(Handler& h) : h_(h) {}
+
+    bool on_object_begin() { return keep(h_.on_object_begin()); }
+    bool on_object_end() { return keep(h_.on_object_end()); }
+    bool on_key(std::string_view key, std::string_view) { return keep(h_.on_key(key)); }
+    bool on_string(std::string_view value, std::string_view) { return keep(h_.on_string(value)); }
+    bool on_number(number value) { return keep(h_.on_number(value), 0); }
+    bool on_bool(bool value) { return keep(h_.on_bool(value), 0); }
+    bool on_null() { return keep(h_.on_null(), 0); }
+    bool on_array_begin() { return keep(h_.on_array_begin()); }
+    bool on_array_end() { return keep(h_.on_array_end()); }
+
+    bool skip_object() {
+        if constexpr (can_skip<Handler>::value) return h_.skip_object();
+        else return false;
+    }
+
+    bool on_object_skipped(std::string_view raw) {
+        if constexpr (can_skip<Handler>::value) return keep(h_.on_object_skipped(raw));
+        else return true;
+    }
+
+    bool stopped() const { return stopped_; }
+
+    // From the char the parse stopped on to the end of the token
+    size_t past() const { return past_; }
+
+private:
+    // A number or a literal ends on the delimiter the parse stops on; the
+    // other tokens end past their last char
+    bool keep(bool go, size_t past = 1) {
+        stopped_ = !go;
+        past_ = past;
+        return go;
+    }
+
+    Handler& h_;
+    bool stopped_{};
+    size_t past_{};
+};
+
+} // namespace detail
+
+template <class Handler>
+sax_result sax_parse(std::string_view s, Handler& h) {
+    detail::sax_adapter<Handler> adapter(h);
+    detail::fsm<detail::sax_adapter<Handler>> fsm(adapter);
+
+    size_t offset = fsm.feed(s);
+    fsm.finish();
+
+    if (adapter.stopped()) return { false, true, offset + adapter.past() };
+    return { fsm.state() == -2, false, offset };
+}
+
+namespace detail {
+
+struct path_span {
+    const std::string_view* keys;
+    size_t size;
+};
+
+//
+// Finds the string members at the given paths. Objects which are not on any
+// of the paths, and the objects in arrays, are skipped by matching their
+// braces, and the parse stops once all the values are found. Up to 64 paths
+// are searched at once.
+//
+class path_handler {
+public:
+    path_handler(const path_span* paths, size_t count, std::optional<std::string_view>* values)
+        : paths_(paths), values_(values), left_(count),
+          all_(count < 64 ? (uint64_t(1) << count) - 1 : ~uint64_t(0)) {}
+
+    bool on_object_begin() {
+        const uint64_t m = arrays_ ? 0 : depth_ ? deeper(key_) : all_;
+        ++depth_;
+        if (depth_ < max_depth_) masks_[depth_] = m;
+        key_ = 0;
+        return true;
+    }
+
+    bool on_object_end() {
+        --depth_;
+        key_ = 0;
+        return true;
+    }
+
+    bool on_key(std::string_view key, std::string_view) {
+        const uint64_t m = depth_ < max_depth_ ? masks_[depth_] : 0;
+        key_ = 0;
+        for (uint64_t b = m; b; b &= b - 1) {
+            const size_t i = ctz64(b);
+            if (paths_[i].keys[depth_ - 1] == key) key_ |= uint64_t(1) << i;
+        }
+        return true;
+    }
+
+    // The value is returned as it is in the input
+    bool on_string(std::string_view, std::string_view raw) {
+        if (arrays_) return true;
+
+        for (uint64_t b = key_; b; b &= b - 1) {
+            const size_t i = ctz64(b);
+            if (paths_[i].size != depth_ || values_[i]) continue;
+            values_[i] = raw;
+            --left_;
+        }
+        key_ = 0;
+        return left_ != 0;
+    }
+
+    bool on_number(number) {
+        key_ = 0;
+        return true;
+    }
+
+    bool on_bool(bool) {
+        key_ = 0;
+        return true;
+    }
+
+    bool on_null() {
+        key_ = 0;
+        return true;
+    }
+
+    bool on_array_begin() {
+        ++arrays_;
+        return true;
+    }
+
+    bool on_array_end() {
+        --arrays_;
+        key_ = 0;
+        return true;
+    }
+
+    bool skip_object() { return arrays_ || !deeper(key_); }
+
+    bool on_object_skipped(std::string_view) {
+        key_ = 0;
+        return true;
+    }
+
+    bool found_all() const { return !left_; }
+
+private:
+    static constexpr size_t max_depth_ = 64;
+
+    static size_t ctz64(uint64_t b) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<size_t>(__builtin_ctzll(b));
+#else
+        size_t n = 0;
+        for (; !(b & 1); b >>= 1) ++n;
+        return n;
+#endif
+    }
+
+    // The paths of the mask which go below the current depth
+    uint64_t deeper(uint64_t m) const {
+        uint64_t d = 0;
+        for (uint64_t b = m; b; b &= b - 1) {
+            const size_t i = ctz64(b);
+            if (paths_[i].size > depth_) d |= uint64_t(1) << i;
+        }
+        return d;
+    }
+
+    const path_span* paths_;
+    std::optional<std::string_view>* values_;
+    size_t left_;
+    uint64_t all_;
+
+    // Paths which match the open objects at every depth
+    std::array<uint64_t, max_depth_> masks_{};
+    size_t depth_{};
+
+    // Paths which match the current key
+    uint64_t key_{};
+    size_t arrays_{};
+};
+
+inline bool extract(std::string_view doc, const path_span* paths, size_t count,
+                    std::optional<std::string_view>* values) {
+    path_handler h(paths, count, values);
+    fsm<path_handler> fsm(h);
+    fsm.feed(doc);
+    fsm.finish();
+    return fsm.state() == -2 || h.found_all();
+}
+
+} // namespace detail
+
+//
+// Extracts the string member at the path without building a document:
+//
+//    auto server = mjson::extract(msg, { "Firmware", "Update", "Server" });
+//
+// Objects off the path are skipped by matching their braces and the parse
+// stops at the value, so the rest of the document is not validated. Returns
+// nothing if the member is missing, is not a string or the document is
+// invalid before it. The value is the raw text of the input: one with
+// escapes is decoded by mjson::unescape().
+//
+inline std::optional<std::string_view> extract(std::string_view doc,
+                                               std::initializer_list<std::string_view> path) {
+    if (!path.size()) return std::nullopt;
+
+    const detail::path_span span{ path.begin(), path.size() };
+    std::optional<std::string_view> value;
+    if (!detail::extract(doc, &span, 1, &value)) return std::nullopt;
+    return value;
+}
+
+// Extracts several paths in one pass; the values are in the order of the paths
+inline std::vector<std::optional<std::string_view>> extract_all(
+    std::string_view doc, std::initializer_list<std::initializer_list<std::string_view>> paths) {
+    std::vector<detail::path_span> spans;
+    for (auto& p : paths) spans.push_back({ p.begin(), p.size() });
+
+    std::vector<std::optional<std::string_view>> values(spans.size());
+    for (size_t i = 0; i < spans.size(); i += 64) {
+        // Empty paths can not match anything
+        std::vector<detail::path_span> group;
+        std::vector<size_t> at;
+        for (size_t j = i; j < std::min(i + 64, spans.size()); j++) {
+            if (!spans[j].size) continue;
+            group.push_back(spans[j]);
+            at.push_back(j);
+        }
+
+        std::vector<std::optional<std::string_view>> found(group.size());
+        if (group.empty() || !detail::extract(doc, group.data(), group.size(), found.data()))
+            return std::vector<std::optional<std::string_view>>(spans.size());
+
+        for (size_t j = 0; j < group.size(); j++) values[at[j]] = found[j];
+    }
+
+    return values;
+}
+
+namespace detail {
+
+//
+// Keys of the open objects for the duplicate check. The keys and a marker at
+// the start of every object are kept in one stack, and found by their hash
+// through an open addressing table of stack positions; the slot depends on
+// the object too, so the same keys of nested objects do not collide. A closed
+// object leaves its positions in the table until the table is rebuilt; only
+// the positions above the marker of the innermost object are its keys. Up to
+// 64 keys and markers are kept inline, so a usual document is checked with no
+// allocation.
+//
+class key_check {
+public:
+    key_check() = default;
+    key_check(const key_check&) = delete;
+    key_check& operator=(const key_check&) = delete;
+
+    // A marker keeps the position of the marker before it in place of a hash
+    void open() {
+        push({ marker_, nullptr, 0, false });
+        marker_ = top_ - 1;
+    }
+
+    void close() {
+        top_ = marker_;
+        marker_ = records_[marker_].hash;
+    }
+
+    // False if the innermost object has the key already
+    bool insert(std::string_view raw) {
+        const bool escaped = std::memchr(raw.data(), '\\', raw.size()) != nullptr;
+        key_hash h;
+        if (escaped) unescape(raw, h);
+        else h.append(raw.data(), raw.size());
+        const size_t hash = h.value();
+
+        const size_t mask = size_ - 1;
+        size_t i = slot(hash, marker_) & mask;
+        for (; slots_[i]; i = (i + 1) & mask) {
+            const size_t r = slots_[i] - 1;
+            if (r > marker_ && r < top_ && records_[r].hash == hash && same(records_[r], raw, escaped))
+                return false;
+        }
+
+        push({ hash, raw.data(), static_cast<uint32_t>(raw.size()), escaped });
+        if (++used_ * 2 > size_) rebuild();
+        else slots_[i] = static_cast<uint32_t>(top_);
+        return true;
+    }
+
+private:
+    struct record {
+        size_t hash;
+        const char* key;        // raw; null for a marker
+        uint32_t length;
+        bool escaped;
+    };
+
+    std::array<record, 64> inline_records_{};
+    std::array<uint32_t, 128> inline_slots_{};
+    std::vector<record> more_records_{};
+    std::vector<uint32_t> more_slots_{};
+
+    record* records_{ inline_records_.data() };
+    size_t capacity_{ inline_records_.size() };
+    size_t top_{};
+    size_t marker_{};
+
+    uint32_t* slots_{ inline_slots_.data() };   // position + 1; 0 is a free slot
+    size_t size_{ inline_slots_.size() };
+    size_t used_{};
+
+    static size_t slot(size_t hash, size_t marker) {
+        return hash ^ static_cast<size_t>(marker * 0x9e3779b97f4a7c15ull);
+    }
+
+    void push(const record& r) {
+        if (top_ == capacity_) {
+            if (records_ == inline_records_.data()) more_records_.assign(records_, records_ + top_);
+            more_records_.resize(capacity_ * 2);
+            records_ = more_records_.data();
+            capacity_ *= 2;
+        }
+        records_[top_++] = r;
+    }
+
+    // Drops the positions of the closed objects and keeps the load factor
+    // under 1/4 for the keys of the open ones
+    void rebuild() {
+        size_t keys = 0;
+        for (size_t r = 0; r < top_; r++) keys += records_[r].key != nullptr;
+
+        size_ = inline_slots_.size();
+        while (size_ < keys * 4) size_ *= 2;
+        if (size_ > inline_slots_.size()) {
+            more_slots_.assign(size_, 0);
+            slots_ = more_slots_.data();
+        } else {
+            inline_slots_.fill(0);
+            slots_ = inline_slots_.data();
+        }
+
+        const size_t mask = size_ - 1;
+        for (size_t r = 0, marker = 0; r < top_; r++) {
+            if (!records_[r].key) {
+                marker = r;
+                continue;
+            }
+
+            size_t i = slot(records_[r].hash, marker) & mask;
+            while (slots_[i]) i = (i + 1) & mask;
+            slots_[i] = static_cast<uint32_t>(r + 1);
+        }
+        used_ = keys;
+    }
+
+    // Keys with escapes are decoded to compare, which happens only for a
+    // duplicate or a collision of the hashes
+    static bool same(const record& r, std::string_view raw, bool escaped) {
+        const std::string_view key(r.key, r.length);
+        if (!r.escaped && !escaped) return key == raw;
+
+        std::string a, b;
+        unescape(key, a);
+        unescape(raw, b);
+        return a == b;
+    }
+};
+
+// Runs the state machine with the checks of the builder and no document
+class validator {
+public:
+    static constexpr bool raw_strings = true;
+
+    bool on_object_begin() {
+        keys_.open();
+        return true;
+    }
+
+    bool on_object_end() {
+        keys_.close();
+        return true;
+    }
+
+    bool on_key(std::string_view, std::string_view raw) { return keys_.insert(raw); }
+    bool on_string(std::string_view, std::string_view) { return true; }
+    bool on_number(number) { return true; }
+    bool on_bool(bool) { return true; }
+    bool on_null() { return true; }
+    bool on_array_begin() { return true; }
+    bool on_array_end() { return true; }
+
+private:
+    key_check keys_{};
+};
+
+} // namespace detail
+
+// Result of validate()
+struct validation {
+    bool valid = false;
+
+    // The end of a valid document; the char at which an invalid one turned
+    // out to be invalid, or the size of the input if it ended too early
+    size_t offset = 0;
+
+    explicit operator bool() const { return valid; }
+};
+
+//
+// Checks that the input is a document json accepts, without building it:
+// only the state machine runs, with the scanner kernels, and the keys of every
+// object are checked for duplicates. Nothing is allocated unless the objects
+// open at once hold more than 64 keys or the nesting is deeper than 256.
+//
+inline validation validate(std::string_view s, size_t max_depth = default_max_depth) {
+    detail::validator v;
+    detail::fsm<detail::validator> fsm(v);
+    fsm.set_max_depth(max_depth);
+    const size_t consumed = fsm.feed(s, true);
+    fsm.finish();
+    return { fsm.state() == -2, consumed };
+}
+
+using json = basic_json<std::string>;
+using json_view = basic_json<std::string_view>;
+using stream_parser = basic_stream_parser<json>;
+using document_stream = basic_document_stream<json>;
+using document_view_stream = basic_document_stream<json_view>;
+using parser = basic_parser<json>;
+using view_parser = basic_parser<json_view>;
+using config_snapshot = basic_config_snapshot<json>;
+
+namespace detail {
+
+//
+// Two-phase parser of one large document, a chunk of the input per thread.
+// Phase one finds the commas between the members of the outermost object:
+// every chunk counts its unescaped quotes and its change of depth for both
+// string states at its start, a prefix over the chunks gives the state and
+// depth at the start of every chunk, and then every chunk up to the one where
+// the outermost object closes looks for its first comma at depth 1. Phase two
+// parses the members between the commas in braces on all the threads and
+// moves them into the first object.
+//
+// A group of members in braces is valid exactly if the document is, whichever
+// commas are found, so any error falls back to the parse on one thread, which
+// gives the same state as json does.
+//
+template <class Json>
+class parallel_parser {
+public:
+    parallel_parser(unsigned threads, const options& opt) : threads_(threads), options_(opt) {}
+
+    // A view or a lazy json keeps the mapping
+    Json parse_file(const std::string& path) const {
+        auto file = std::make_shared<const mapped_file>(path);
+        if (!file->is_open()) {
+            Json js;
+            js.state_ = -1;
+            return js;
+        }
+
+        std::shared_ptr<const void> owner;
+        if (Json::is_view_ || options_.lazy) owner = file;
+        return parse(file->view(), owner);
+    }
+
+    Json parse(std::string_view s, std::shared_ptr<const void> owner = nullptr) const {
+        const size_t chunks = std::min<size_t>(threads_, s.size() / grain_);
+        if (chunks < 2 || options_.lazy) return single(s, owner);
+
+        const std::vector<size_t> commas = split(s, chunks);
+        std::vector<Json> groups(commas.size() + 1);
+        run(groups.size(), [&](size_t g) {
+            const size_t b = g ? commas[g - 1] + 1 : 0;
+            const size_t e = g < commas.size() ? commas[g] : s.size();
+
+            groups[g].owner_ = owner;
+            groups[g].options_ = options_;
+            groups[g].parse(s, { g ? "{" : "", s.substr(b, e - b), g < commas.size() ? "}" : "" });
+        });
+
+        // An empty group is a comma with no member before or after it
+        Json& root = groups[0];
+        for (size_t g = 0; g < groups.size(); g++) {
+            if (!groups[g].is_valid() || (groups.size() > 1 && !groups[g].size())) return single(s, owner);
+            if (g && !root.absorb(groups[g])) return single(s, owner);
+        }
+        return std::move(root);
+    }
+
+private:
+    // Smallest chunk worth a thread
+    static constexpr size_t grain_ = 256 * 1024;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    unsigned threads_;
+    options options_;
+
+    struct summary {
+        bool flip;                  // odd number of quotes
+        ptrdiff_t depth[2];         // out of a string or in one at the start
+        ptrdiff_t low[2];           // least depth after a closing bracket
+    };
+
+    // A lazy json keeps a copy of the input which nothing else keeps alive
+    Json single(std::string_view s, const std::shared_ptr<const void>& owner) const {
+        if (options_.lazy && !owner) return Json(s, options_);
+
+        Json js;
+        js.owner_ = owner;
+        js.options_ = options_;
+        js.parse(s);
+        return js;
+    }
+
+    template <class Fn>
+    static void run(size_t count, const Fn& fn) {
+        if (!count) return;
+
+        std::vector<std::thread> pool;
+        for (size_t i = 1; i < count; i++) pool.emplace_back(fn, i);
+        fn(0);
+        for (auto& t : pool) t.join();
+    }
+
+    // A backslash escapes the next char out of strings as well, which only
+    // happens in invalid documents
+    static bool escaped(std::string_view s, size_t b) {
+        size_t i = b;
+        while (i && s[i - 1] == '\\') --i;
+        return (b - i) & 1;
+    }
+
+    static summary summarize(std::string_view s, size_t b, size_t e) {
+        bool esc = escaped(s, b);
+        bool in = false;
+        ptrdiff_t depth[2] = { 0, 0 };
+        ptrdiff_t low[2] = { PTRDIFF_MAX, PTRDIFF_MAX };
+
+        for (size_t i = b; i < e; i++) {
+            const char c = s[i];
+            if (esc) esc = false;
+            else if (c == '\\') esc = true;
+            else if (c == '"') in = !in;
+            else if (c == '{' || c == '[') ++depth[in];
+            else if (c == '}' || c == ']') low[in] = std::min(low[in], --depth[in]);
+        }
+        return { in, { depth[0], depth[1] }, { low[0], low[1] } };
+    }
+
+    // The parse stops where the outermost object closes, so no comma after
+    // it is a split point
+    static size_t first_comma(std::string_view s, size_t b, size_t e, bool in, ptrdiff_t depth) {
+        bool esc = escaped(s, b);
+        for (size_t i = b; i < e; i++) {
+            const char c = s[i];
+            if (esc) esc = false;
+            else if (c == '\\') esc = true;
+            else if (c == '"') in = !in;
+            else if (in) continue;
+            else if (c == '{' || c == '[') ++depth;
+            else if ((c == '}' || c == ']') && --depth <= 0) return npos;
+            else if (c == ',' && depth == 1) return i;
+        }
+        return npos;
+    }
+
+    // The first comma of the outermost object in every chunk but the first
+    std::vector<size_t> split(std::string_view s, size_t chunks) const {
+        const auto begin = [&](size_t c) { return s.size() * c / chunks; };
+
+        std::vector<summary> sums(chunks);
+        run(chunks, [&](size_t c) { sums[c] = summarize(s, begin(c), begin(c + 1)); });
+
+        // The chunks after the one where the outermost object closes have
+        // no split points
+        std::vector<std::pair<bool, ptrdiff_t>> starts(chunks);
+        bool in = false;
+        ptrdiff_t depth = 0;
+        size_t open = 0;
+        for (; open < chunks; open++) {
+            starts[open] = { in, depth };
+            if (sums[open].low[in] != PTRDIFF_MAX && depth + sums[open].low[in] <= 0) break;
+            depth += sums[open].depth[in];
+            in ^= sums[open].flip;
+        }
+        open = std::min(open + 1, chunks);
+
+        std::vector<size_t> found(chunks, npos);
+        run(open - 1, [&](size_t c) {
+            ++c;
+            found[c] = first_comma(s, begin(c), begin(c + 1), starts[c].first, starts[c].second);
+        });
+
+        std::vector<size_t> commas;
+        for (size_t f : found)
+            if (f != npos) commas.push_back(f);
+        return commas;
+    }
+};
+
+} // namespace detail
+
+//
+// Parses one large document on the given number of threads; 0 uses all the
+// hardware threads. The members of the outermost object are split between
+// the threads, so a document with a few huge members scales only as far as
+// their number. A document under 256 KB per thread, or a lazy one, is parsed
+// on the calling thread. A view refers to the input, which must outlive it.
+//
+template <class Json = json>
+Json parse_parallel(std::string_view s, unsigned threads = 0, const options& opt = options()) {
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+    return detail::parallel_parser<Json>(threads, opt).parse(s);
+}
+
+// Parses the file in parallel from its mapped pages, which a view keeps
+// mapped; a missing file gives an invalid document
+template <class Json = json>
+Json parse_parallel_file(const std::string& path, unsigned threads = 0, const options& opt = options()) {
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+    return detail::parallel_parser<Json>(threads, opt).parse_file(path);
+}
+
+#ifdef MJSON_PMR
+namespace pmr {
+
+using json = basic_json<std::pmr::string, std::pmr::polymorphic_allocator<char>>;
+using json_view = basic_json<std::string_view, std::pmr::polymorphic_allocator<char>>;
+using stream_parser = basic_stream_parser<json>;
+using document_stream = basic_document_stream<json>;
+using document_view_stream = basic_document_stream<json_view>;
+using parser = basic_parser<json>;
+using view_parser = basic_parser<json_view>;
+
+} // namespace pmr
+
+template <class Json>
+class basic_batch;
+
+template <class Json = pmr::json>
+basic_batch<Json> parse_batch(const std::string_view* docs, size_t count, unsigned threads = 0);
+
+//
+// Documents of a batch parsed in parallel, in the input order. Every worker
+// allocates its documents from its own arena, which is released together
+// with the batch.
+//
+template <class Json>
+class basic_batch {
+public:
+    size_t size() const { return docs_.size(); }
+    Json& operator[](size_t i) { return *docs_[i]; }
+
+private:
+    template <class J>
+    friend basic_batch<J> parse_batch(const std::string_view* docs, size_t count, unsigned threads);
+
+    // Arenas are declared first so the documents are destroyed before them
+    std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> arenas_{};
+    std::vector<std::optional<Json>> docs_{};
+};
+
+using batch = basic_batch<pmr::json>;
+
+namespace detail {
+
+//
+// Range of the documents [begin, end) still to be parsed by a worker, packed
+// into one word. The owner takes documents from the front and the others
+// steal the back half when they run out of work.
+//
+struct alignas(64) work_range {
+    std::atomic<uint64_t> range{};
+
+    static uint64_t pack(uint32_t b, uint32_t e) { return (uint64_t(b) << 32) | e; }
+    static uint32_t begin(uint64_t r) { return static_cast<uint32_t>(r >> 32); }
+    static uint32_t end(uint64_t r) { return static_cast<uint32_t>(r); }
+
+    bool pop(uint32_t& i) {
+        uint64_t r = range.load(std::memory_order_relaxed);
+        while (begin(r) < end(r)) {
+            if (range.compare_exchange_weak(r, pack(begin(r) + 1, end(r)), std::memory_order_acquire)) {
+                i = begin(r);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Moves the back half of the victim's range to this one, which is empty
+    bool steal(work_range& victim) {
+        uint64_t r = victim.range.load(std::memory_order_relaxed);
+        while (begin(r) < end(r)) {
+            const uint32_t mid = begin(r) + (end(r) - begin(r)) / 2;
+            if (victim.range.compare_exchange_weak(r, pack(begin(r), mid), std::memory_order_acquire)) {
+                range.store(pack(mid, end(r)), std::memory_order_release);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace detail
+
+//
+// Parses independent documents on the given number of threads; 0 uses all
+// the hardware threads. The calling thread is one of the workers. A view
+// batch refers to the input strings, which must outlive it.
+//
+template <class Json>
+basic_batch<Json> parse_batch(const std::string_view* docs, size_t count, unsigned threads) {
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(count, 1)));
+
+    basic_batch<Json> b;
+    b.docs_.resize(count);
+
+    std::vector<detail::work_range> work(threads);
+    for (unsigned t = 0; t < threads; t++) {
+        work[t].range = detail::work_range::pack(static_cast<uint32_t>(count * t / threads),
+                                                 static_cast<uint32_t>(count * (t + 1) / threads));
+        b.arenas_.push_back(std::make_unique<std::pmr::monotonic_buffer_resource>());
+    }
+
+    auto worker = [&](unsigned t) {
+        auto* arena = b.arenas_[t].get();
+        for (;;) {
+            uint32_t i;
+            while (work[t].pop(i)) b.docs_[i].emplace(docs[i], arena);
+
+            // Out of work: steal from the others until all of them are empty
+            bool stolen = false;
+            for (unsigned v = 1; v < threads && !stolen; v++)
+                stolen = work[t].steal(work[(t + v) % threads]);
+            if (!stolen) return;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+
+    return b;
+}
+
+template <class Json = pmr::json>
+basic_batch<Json> parse_batch(const std::vector<std::string_view>& docs, unsigned threads = 0) {
+    return parse_batch<Json>(docs.data(), docs.size(), threads);
+}
+#endif
+
 } // namespace mjson
@@ -14,6 +14,10 @@
 #include "catch.hpp"
 
 #include <mjson/mjson.hpp>
+
+#include <charconv>
+#include <cstdio>
+#include <fstream>
 using namespace mjson;
 
 TEST_CASE("Empty string", "[header]") {
@@ -641,6 +645,322 @@ TEST_CASE("Valid array", "[array]") {
     }
 }
 
+TEST_CASE("Numbers", "[number]") {
+    SECTION("Integers") {
+        json js(R"({ "a" : 0, "b" : -0, "c" : 42, "d" : -17,
+                     "max" : 9223372036854775807, "min" : -9223372036854775808,
+                     "big" : 9223372036854775808 })");
+        REQUIRE(js.is_valid());
+        REQUIRE(js.size() == 7);
+        REQUIRE(js.has_number("a"));
+        REQUIRE(js.get_number("a").is_integer());
+        REQUIRE(js.get_int("a") == 0);
+        REQUIRE(js.get_int("b") == 0);
+        REQUIRE(js.get_int("c") == 42);
+        REQUIRE(js.get_int("d") == -17);
+        REQUIRE(js.get_int("max") == std::numeric_limits<int64_t>::max());
+        REQUIRE(js.get_int("min") == std::numeric_limits<int64_t>::min());
+        REQUIRE_FALSE(js.get_number("big").is_integer());
+        REQUIRE(js.get_double("big") == 9223372036854775808.0);
+        REQUIRE(js.get_double("c") == 42.0);
+    }
+
+    SECTION("Doubles") {
+        json js(R"({ "a" : 1.5, "b" : -0.25, "c" : 1e3, "d" : 2.5E-3, "e" : 1.0,
+                     "f" : 0.1, "g" : 123456.789e-2, "h" : 1.7976931348623157e308,
+                     "i" : 4.9e-324, "j" : 3.141592653589793238462643383279, "k" : 1e400 })");
+        REQUIRE(js.is_valid());
+        REQUIRE_FALSE(js.get_number("a").is_integer());
+        REQUIRE(js.get_double("a") == 1.5);
+        REQUIRE(js.get_double("b") == -0.25);
+        REQUIRE(js.get_double("c") == 1000.0);
+        REQUIRE_FALSE(js.get_number("c").is_integer());
+        REQUIRE(js.get_double("d") == 0.0025);
+        REQUIRE(js.get_double("e") == 1.0);
+        REQUIRE(js.get_double("f") == 0.1);
+        REQUIRE(js.get_double("g") == 1234.56789);
+        REQUIRE(js.get_double("h") == std::numeric_limits<double>::max());
+        REQUIRE(js.get_double("i") == std::numeric_limits<double>::denorm_min());
+        REQUIRE(js.get_double("j") == 3.141592653589793);
+        REQUIRE(js.get_double("k") == std::numeric_limits<double>::infinity());
+        REQUIRE(js.get_int("a") == 1);
+    }
+
+    SECTION("Fast path matches std::from_chars") {
+        for (const char* t : { "0.1", "2.5e-7", "123.456", "9007199254740993.0", "1e22", "1e23",
+                               "0.000001", "123456789012345.6", "-98.76e5", "5e-22", "8.41e21" }) {
+            json js(std::string(R"({ "n" : )") + t + " }");
+            REQUIRE(js.is_valid());
+
+            double d = 0;
+            std::from_chars(t, t + std::strlen(t), d);
+            REQUIRE(js.get_double("n") == d);
+        }
+    }
+
+    SECTION("Invalid numbers") {
+        for (const char* t : { "01", "-", "+1", "1.", ".5", "1e", "1e+", "0x10", "1.5.2",
+                               "--1", "1-2", "inf", "NaN", "-a", "1 2", "1\"" }) {
+            REQUIRE_FALSE(json(std::string(R"({ "n" : )") + t + " }").is_valid());
+            REQUIRE_FALSE(json(std::string(R"({ "n" : [ )") + t + " ] }").is_valid());
+        }
+    }
+
+    SECTION("Kinds do not mix") {
+        json js(R"({ "n" : 1, "s" : "1" })");
+        REQUIRE_FALSE(js.has("n"));
+        REQUIRE_FALSE(js.has_number("s"));
+        REQUIRE(js.get_int("s") == 0);
+        REQUIRE(js.get_int("missing") == 0);
+        REQUIRE(js.kind_of(0) == kind::number);
+        REQUIRE(js.get_number(0) == number(int64_t(1)));
+    }
+
+    SECTION("Split between chunks") {
+        const std::string in = R"({ "a" : -12.5e1, "b" : [ 7, 8 ], "c" : 1234567 })";
+        for (size_t i = 0; i <= in.size(); i++) {
+            stream_parser p;
+            p.feed(in.data(), i);
+            p.feed(in.data() + i, in.size() - i);
+
+            json js = p.finish();
+            REQUIRE(js.is_valid());
+            REQUIRE(js.get_double("a") == -125.0);
+            REQUIRE(js.get_list("b").get_number(1) == number(int64_t(8)));
+            REQUIRE(js.get_int("c") == 1234567);
+        }
+    }
+}
+
+TEST_CASE("Literals", "[literal]") {
+    SECTION("Valid") {
+        json js(R"({ "t" : true, "f" : false, "n" : null, "l" : [ true, false, null ] })");
+        REQUIRE(js.is_valid());
+        REQUIRE(js.has_bool("t"));
+        REQUIRE(js.get_bool("t"));
+        REQUIRE(js.has_bool("f"));
+        REQUIRE_FALSE(js.get_bool("f"));
+        REQUIRE(js.is_null("n"));
+        REQUIRE_FALSE(js.is_null("t"));
+        REQUIRE_FALSE(js.has_bool("n"));
+        REQUIRE_FALSE(js.get_bool("missing"));
+
+        json& l = js.get_list("l");
+        REQUIRE(l.size() == 3);
+        REQUIRE(l.kind_of(0) == kind::boolean);
+        REQUIRE(l.get_bool(0));
+        REQUIRE_FALSE(l.get_bool(1));
+        REQUIRE(l.kind_of(2) == kind::null);
+    }
+
+    SECTION("Invalid") {
+        for (const char* t : { "tru", "truee", "True", "nul", "nulll", "f", "falsy", "t rue" })
+            REQUIRE_FALSE(json(std::string(R"({ "v" : )") + t + " }").is_valid());
+    }
+}
+
+TEST_CASE("Lists", "[list]") {
+    const std::string in = R"({
+        "strings" : [ "a", "b" ],
+        "mixed" : [ "a", 1, true, null, "b" ],
+        "nested" : [ [ "x", "y" ], [ [ 1 ], [] ], [] ],
+        "objects" : [ { "k" : "v" }, { "k" : [ 2.5 ] } ],
+        "empty" : [],
+        "tail" : "end"
+    })";
+
+    SECTION("Arrays of strings stay arrays") {
+        json js(in);
+        REQUIRE(js.is_valid());
+        REQUIRE(js.has_array("strings"));
+        REQUIRE(js.get_array("strings") == json::Array{ "a", "b" });
+        REQUIRE(js.has_array("empty"));
+        REQUIRE_FALSE(js.has_list("strings"));
+        REQUIRE(js["tail"] == "end");
+    }
+
+    SECTION("Mixed items") {
+        json js(in);
+        REQUIRE(js.has_list("mixed"));
+        REQUIRE_FALSE(js.has_array("mixed"));
+
+        json& l = js.get_list("mixed");
+        REQUIRE(l.is_valid());
+        REQUIRE(l.size() == 5);
+        REQUIRE(l.key(0).empty());
+        REQUIRE(l.get(0) == "a");
+        REQUIRE(l.get_number(1).as_int() == 1);
+        REQUIRE(l.get_bool(2));
+        REQUIRE(l.kind_of(3) == kind::null);
+        REQUIRE(l.get(4) == "b");
+    }
+
+    SECTION("Nested arrays and objects") {
+        json js(in);
+        json& n = js.get_list("nested");
+        REQUIRE(n.size() == 3);
+        REQUIRE(n.get_array(0) == json::Array{ "x", "y" });
+        REQUIRE(n.kind_of(1) == kind::list);
+        REQUIRE(n.get_list(1).get_list(0).get_number(0).as_int() == 1);
+        REQUIRE(n.get_list(1).get_array(1).empty());
+        REQUIRE(n.get_array(2).empty());
+
+        json& o = js.get_list("objects");
+        REQUIRE(o.size() == 2);
+        REQUIRE(o.get_object(0)["k"] == "v");
+        REQUIRE(o.get_object(1).get_list("k").get_number(0).as_double() == 2.5);
+    }
+
+    SECTION("Items after a nested object have no key") {
+        const std::string mixed = R"({"a":[{"xxxxxxxxxxxx":"1"},"s",2,[3],{"y":"4"},null]})";
+
+        json js(mixed);
+        const json& l = js.get_list("a");
+        REQUIRE(l.size() == 6);
+        for (size_t i = 0; i < l.size(); i++) REQUIRE(l.key(i).empty());
+        REQUIRE_FALSE(l.has("xxxxxxxxxxxx"));
+        REQUIRE(l.get(1) == "s");
+        REQUIRE(l.get_number(2).as_int() == 2);
+        REQUIRE(l.kind_of(5) == kind::null);
+
+        json_view view(mixed);
+        const json_view& v = view.get_list("a");
+        for (size_t i = 0; i < v.size(); i++) REQUIRE(v.key(i).empty());
+        REQUIRE_FALSE(v.has("xxxxxxxxxxxx"));
+        REQUIRE_FALSE(v.has("y"));
+        REQUIRE(to_string(view) == to_string(js));
+    }
+
+    SECTION("Long lists are kept in order") {
+        std::string big = R"({ "l" : [ )";
+        for (int i = 0; i < 1000; i++) big += std::to_string(i) + ", ";
+        big += "null ] }";
+
+        json js(big);
+        REQUIRE(js.is_valid());
+        json& l = js.get_list("l");
+        REQUIRE(l.size() == 1001);
+        for (int i = 0; i < 1000; i++) REQUIRE(l.get_number(i).as_int() == i);
+        REQUIRE(l.kind_of(1000) == kind::null);
+    }
+
+    SECTION("View, lazy and reused documents") {
+        json js(in);
+        const std::string expected = to_string(js);
+
+        json_view view(in);
+        REQUIRE(view.get_list("objects").get_object(0)["k"] == "v");
+        REQUIRE(to_string(view) == expected);
+
+        json lazy(in, options{ true });
+        REQUIRE(lazy.get_list("objects").get_object(1).get_list("k").get_number(0).as_double() == 2.5);
+        REQUIRE(to_string(lazy) == expected);
+
+        parser p;
+        json reused;
+        REQUIRE(p.parse(in, reused));
+        REQUIRE(p.parse(R"({ "x" : [ 1 ] })", reused));
+        REQUIRE(p.parse(in, reused));
+        REQUIRE(to_string(reused) == expected);
+    }
+
+    SECTION("Invalid") {
+        REQUIRE_FALSE(json(R"({ "a" : [ [ "x" ] })").is_valid());
+        REQUIRE_FALSE(json(R"({ "a" : [ 1, ] })").is_valid());
+        REQUIRE_FALSE(json(R"({ "a" : [ { "k" : "v" ] } })").is_valid());
+        REQUIRE_FALSE(json(R"({ "a" : [ "x" } })").is_valid());
+        REQUIRE_FALSE(json(R"({ "a" : [ "k" : "v" ] })").is_valid());
+        REQUIRE_FALSE(json(R"({ "a" : [ 1 2 ] })").is_valid());
+        REQUIRE_FALSE(json(R"([ "a" ])").is_valid());
+
+        std::string deep = R"({ "a" : )";
+        deep += std::string(default_max_depth, '[');
+        deep += std::string(default_max_depth, ']') + " }";
+        REQUIRE_FALSE(json(deep).is_valid());
+    }
+}
+
+TEST_CASE("Escapes", "[escape]") {
+    SECTION("Values and keys are decoded") {
+        json js(R"({ "q\"k" : "a\"b\\c\/d", "ws" : "\b\f\n\r\t", "a" : [ "\"", "x\\" ] })");
+        REQUIRE(js.is_valid());
+        REQUIRE(js.key(0) == "q\"k");
+        REQUIRE(js["q\"k"] == "a\"b\\c/d");
+        REQUIRE(js["ws"] == "\b\f\n\r\t");
+        REQUIRE(js.get_array("a").at(0) == "\"");
+        REQUIRE(js.get_array("a").at(1) == "x\\");
+    }
+
+    SECTION("Unicode escapes") {
+        json js(R"({ "e" : "caf\u00e9", "u" : "\u20AcA", "p" : "\ud83d\ude00!", "z" : "\u0000" })");
+        REQUIRE(js.is_valid());
+        REQUIRE(js["e"] == "caf\xc3\xa9");
+        REQUIRE(js["u"] == "\xe2\x82\xac" "A");
+        REQUIRE(js["p"] == "\xf0\x9f\x98\x80!");
+        REQUIRE(js["z"] == std::string(1, '\0'));
+    }
+
+    SECTION("Invalid escapes") {
+        for (const char* v : { R"("\x")", R"("\u12")", R"("\u12g4")", R"("\ud83d")", R"("\ud83dx")",
+                               R"("\ud83dA")", R"("\ude00")", "\"\\\t\"", R"("abc\")" }) {
+            REQUIRE_FALSE(json(std::string(R"({ "v" : )") + v + " }").is_valid());
+            REQUIRE_FALSE(json(std::string("{ ") + v + R"( : "v" })").is_valid());
+        }
+
+        REQUIRE(unescape(R"(a\u00e9\n)") == "a\xc3\xa9\n");
+        REQUIRE_FALSE(unescape(R"(\ud83d)"));
+    }
+
+    SECTION("Split between chunks") {
+        const std::string in = R"({ "k\"ey" : "v\\a\u00e9\uD83D\uDE00l", "a" : [ "\t\"" ] })";
+        for (size_t i = 0; i <= in.size(); i++) {
+            stream_parser p;
+            p.feed(in.data(), i);
+            p.feed(in.data() + i, in.size() - i);
+
+            json js = p.finish();
+            REQUIRE(js.is_valid());
+            REQUIRE(js["k\"ey"] == "v\\a\xc3\xa9\xf0\x9f\x98\x80l");
+            REQUIRE(js.get_array("a").at(0) == "\t\"");
+        }
+    }
+
+    SECTION("View") {
+        const std::string in = R"({ "plain" : "value", "k\u00e9y" : "a\"b",
+                                    "list" : [ 1, "x\ny" ], "obj" : { "\"" : "\\" } })";
+        json_view js(in);
+        REQUIRE(js.is_valid());
+        REQUIRE(js["plain"] == "value");
+        REQUIRE(js["plain"].data() == in.data() + in.find("value"));
+        REQUIRE(js.key(1) == "k\xc3\xa9y");
+        REQUIRE(js["k\xc3\xa9y"] == "a\"b");
+        REQUIRE(js.get_list("list").get(1) == "x\ny");
+        REQUIRE(js.get_object("obj")["\""] == "\\");
+
+        // The decoded strings live as long as the objects which refer to them
+        json_view obj = js.get_object("obj");
+        json_view list = js.get_list("list");
+        js = json_view("{}");
+        REQUIRE(obj.key(0) == "\"");
+        REQUIRE(obj["\""] == "\\");
+        REQUIRE(list.get(1) == "x\ny");
+
+        json_view lazy(in, options{ true });
+        REQUIRE(lazy.get_object("obj")["\""] == "\\");
+    }
+
+    SECTION("Writer round trip") {
+        const std::string in = R"({ "k\"" : "\u00e9\\\n\u0001", "a" : [ "\/" ] })";
+        json js(in);
+        REQUIRE(js.is_valid());
+
+        json again(to_string(js));
+        REQUIRE(again.is_valid());
+        REQUIRE(again["k\""] == "\xc3\xa9\\\n\x01");
+        REQUIRE(again.get_array("a").at(0) == "/");
+    }
+}
+
 TEST_CASE("Invalid object body", "[object]") {
     SECTION("Close bracket is expected") {
         const auto in = R"(
@@ -698,3 +1018,1735 @@ TEST_CASE("Valid object", "[object]") {
         REQUIRE(obj["objkey2"] == "objvalue2");
     }
 }
+
+TEST_CASE("Nested objects", "[object]") {
+    SECTION("Deeply nested objects") {
+        const size_t depth = 200;
+
+        std::string in = "{";
+        for (size_t i = 0; i < depth; i++) in += R"("o" : { "k" : "v", )";
+        in += R"("leaf" : "value")";
+        for (size_t i = 0; i < depth; i++) in += R"(}, "n" : "v")";
+        in += "}";
+
+        json js(in);
+        REQUIRE(js.is_valid());
+        REQUIRE(js.size() == 2);
+
+        json* obj = &js;
+        for (size_t i = 0; i < depth; i++) {
+            REQUIRE(obj->has_object("o"));
+            REQUIRE((*obj)["n"] == "v");
+            obj = &obj->get_object("o");
+            REQUIRE((*obj)["k"] == "v");
+        }
+        REQUIRE(obj->size() == 2);
+        REQUIRE((*obj)["leaf"] == "value");
+    }
+
+    SECTION("Maximum depth") {
+        auto nested = [](size_t depth) {
+            std::string in;
+            for (size_t i = 0; i < depth; i++) in += R"({ "o" : )";
+            in += "{}";
+            for (size_t i = 0; i < depth; i++) in += "}";
+            return in;
+        };
+
+        // The outermost object is at depth 1
+        REQUIRE(json(nested(default_max_depth - 1)).is_valid());
+        REQUIRE_FALSE(json(nested(default_max_depth)).is_valid());
+        REQUIRE_FALSE(json_view(nested(default_max_depth)).is_valid());
+
+        const std::string deep = nested(2000);
+        REQUIRE(json(deep, options{ false, 3000 }).is_valid());
+        REQUIRE_FALSE(json(deep, options{ false, 2000 }).is_valid());
+
+        REQUIRE(json(R"({ "o" : { "o" : {} } })", options{ false, 3 }).is_valid());
+        REQUIRE_FALSE(json(R"({ "o" : { "o" : {} } })", options{ false, 2 }).is_valid());
+
+        // Lazy objects keep the limit of the document they belong to
+        json lazy(R"({ "o" : { "o" : { "o" : {} } } })", options{ true, 3 });
+        REQUIRE(lazy.is_valid());
+        REQUIRE_FALSE(lazy.get_object("o").get_object("o").is_valid());
+        json lazy_ok(R"({ "o" : { "o" : { "o" : {} } } })", options{ true, 4 });
+        REQUIRE(lazy_ok.get_object("o").get_object("o").get_object("o").is_valid());
+
+        // Unbalanced input fails at the limit instead of growing the stack
+        const std::string opening(1000000, '{');
+        REQUIRE_FALSE(json(R"({ "o" : )" + opening).is_valid());
+
+        stream_parser sp(options{ false, 2 });
+        REQUIRE_FALSE(sp.feed(R"({ "o" : { "o" : {)", 17));
+
+        parser p(options{ false, 2 });
+        json js;
+        REQUIRE(p.parse(R"({ "o" : {} })", js));
+        REQUIRE_FALSE(p.parse(R"({ "o" : { "o" : {} } })", js));
+    }
+
+    SECTION("Sibling objects") {
+        const auto in = R"(
+            {
+                "o1" : { "k" : "v1" },
+                "o2" : { "k" : "v2", "o3" : { "k" : "v3" } },
+                "k" : "v"
+            }
+        )";
+
+        json js(in);
+        REQUIRE(js.is_valid());
+        REQUIRE(js.size() == 3);
+        REQUIRE(js.get_object("o1")["k"] == "v1");
+        REQUIRE(js.get_object("o2")["k"] == "v2");
+        REQUIRE(js.get_object("o2").get_object("o3")["k"] == "v3");
+        REQUIRE(js["k"] == "v");
+    }
+
+    SECTION("Truncated nested object") {
+        const auto in = R"(
+            {
+                "o1" : { "o2" : { "k" : "v" }
+        )";
+
+        json js(in);
+        REQUIRE_FALSE(js.is_valid());
+        REQUIRE(js.size() == 0);
+    }
+}
+
+TEST_CASE("Validation", "[validate]") {
+    const std::string in = R"({ "Device" : "Heart\"MN1", "Image" : [ "PBS-09", [ 1, -2.5e3 ], { "k" : null } ],
+        "Firmware" : { "Version" : "1.9", "Update" : { "Server" : "https://update.com", "é" : true } },
+        "Empty" : { }, "List" : [ ], "Signature" : "e161fd8a" })";
+
+    SECTION("Same as json") {
+        REQUIRE(validate(in));
+        REQUIRE(validate(in).offset == in.size());
+
+        // Every truncation and a few chars put in every place
+        for (size_t n = 0; n < in.size(); n++) {
+            const std::string cut = in.substr(0, n);
+            REQUIRE(bool(validate(cut)) == json(cut).is_valid());
+
+            for (char c : { '"', '\\', '{', '}', ',', ':', '1', ' ', '\n' }) {
+                std::string bad = in;
+                bad[n] = c;
+                REQUIRE(bool(validate(bad)) == json(bad).is_valid());
+            }
+        }
+    }
+
+    SECTION("Error offsets") {
+        REQUIRE(validate(R"({ "a" : x })").offset == 8);
+        REQUIRE(validate(R"({ "a" : "b" )").offset == 12);
+        REQUIRE(validate(R"({ "a" : "b", })").offset == 13);
+        REQUIRE(validate(R"({ "a" : "\q" })").offset == 11);
+        REQUIRE(validate(R"({ "a" : 1 } tail)").offset == 11);
+        REQUIRE(validate(R"({ "a" : 1 } tail)"));
+        REQUIRE_FALSE(validate(""));
+    }
+
+    SECTION("Duplicate keys") {
+        REQUIRE(validate(R"({ "a" : 1, "a" : 2 })").offset == 13);
+        REQUIRE_FALSE(validate(R"({ "a" : 1, "a" : 2 })"));
+        REQUIRE_FALSE(validate(R"({ "é" : 1, "é" : 2 })"));
+        REQUIRE(validate(R"({ "a" : { "a" : { "a" : 1 } }, "b" : [ { "a" : 1 }, { "a" : 2 } ] })"));
+        REQUIRE_FALSE(validate(R"({ "a" : { "b" : 1 }, "c" : { "d" : 1, "d" : 2 } })"));
+        REQUIRE_FALSE(validate(R"({ "a" : { "b" : 1 }, "c" : 2, "a" : 3 })"));
+    }
+
+    SECTION("Wide and repeated objects") {
+        std::string wide = "{";
+        for (int i = 0; i < 1000; i++) wide += (i ? "," : "") + std::string("\"k") + std::to_string(i) + "\":{\"x\":1,\"y\":2}";
+
+        REQUIRE(validate(wide + "}"));
+        REQUIRE_FALSE(validate(wide + ",\"k500\":1}"));
+        REQUIRE(validate(wide + ",\"k1000\":1}"));
+
+        std::string items = "{ \"items\" : [";
+        for (int i = 0; i < 1000; i++) items += std::string(i ? "," : "") + "{\"id\":1,\"name\":\"n\",\"tags\":[\"a\"]}";
+        REQUIRE(validate(items + "] }"));
+        REQUIRE_FALSE(validate(items + ",{\"id\":1,\"id\":2}] }"));
+    }
+
+    SECTION("Depth") {
+        const std::string deep = std::string(300, '[');
+        const std::string doc = "{ \"a\" : " + deep + std::string(300, ']') + " }";
+        REQUIRE(validate(doc));
+        REQUIRE_FALSE(validate(doc, 100));
+        REQUIRE(bool(validate(doc, 301)) == json(doc).is_valid());
+        REQUIRE_FALSE(validate(doc, 300));
+    }
+}
+
+TEST_CASE("Json view", "[view]") {
+    const std::string in = R"(
+        {
+            "key" : "value",
+            "array" : [ "i1", "i2" ],
+            "object" : {
+                "objkey" : "objvalue"
+            }
+        }
+    )";
+
+    const auto in_buffer = [&in](std::string_view sv) {
+        return sv.data() >= in.data() && sv.data() + sv.size() <= in.data() + in.size();
+    };
+
+    SECTION("Values are slices of the input") {
+        json_view js(in);
+        REQUIRE(js.is_valid());
+        REQUIRE(js.size() == 3);
+        REQUIRE(js["key"] == "value");
+        REQUIRE(in_buffer(js["key"]));
+
+        REQUIRE(js.has_array("array"));
+        REQUIRE(js.get_array("array").size() == 2);
+        REQUIRE(js.get_array("array").at(0) == "i1");
+        REQUIRE(js.get_array("array").at(1) == "i2");
+        REQUIRE(in_buffer(js.get_array("array").at(1)));
+
+        REQUIRE(js.has_object("object"));
+        json_view& obj = js.get_object("object");
+        REQUIRE(obj.size() == 1);
+        REQUIRE(obj["objkey"] == "objvalue");
+        REQUIRE(in_buffer(obj["objkey"]));
+    }
+
+    SECTION("Owned buffer") {
+        auto js = std::make_unique<json_view>(std::string{in});
+        REQUIRE(js->is_valid());
+        REQUIRE((*js)["key"] == "value");
+        REQUIRE_FALSE(in_buffer((*js)["key"]));
+
+        json_view obj = js->get_object("object");
+        js.reset();
+        REQUIRE(obj["objkey"] == "objvalue");
+    }
+
+    SECTION("Missing keys are not inserted") {
+        json_view js(in);
+        REQUIRE(js["missing"] == "");
+        REQUIRE(js.get_array("missing").empty());
+        REQUIRE(js.get_object("missing").size() == 0);
+        REQUIRE_FALSE(js.has("missing"));
+        REQUIRE(js.size() == 3);
+
+        // A const document reads missing objects as one shared read only
+        // object; a non-const one empties its own again on every miss
+        const json_view other(in);
+        REQUIRE(&other.get_object("missing") == &other.get_list("none"));
+        static_assert(std::is_const_v<std::remove_reference_t<decltype(other.get_object("missing"))>>);
+
+        js.get_object("missing") = json_view(R"({ "k" : "v" })");
+        REQUIRE(js.get_object("missing").size() == 0);
+        REQUIRE(js.get_list("none").size() == 0);
+        REQUIRE(other.get_object("missing").size() == 0);
+    }
+
+    SECTION("Not valid") {
+        json_view js(R"({ "key" : "value", "key" : "value" })");
+        REQUIRE_FALSE(js.is_valid());
+        REQUIRE(js.size() == 0);
+    }
+}
+
+TEST_CASE("Scanner kernels", "[scanner]") {
+    const scan_kernel kernels[] = {
+        scan_kernel::bytewise, scan_kernel::scalar, scan_kernel::sse2, scan_kernel::avx2
+    };
+    const scan_kernel active = get_scan_kernel();
+
+    SECTION("Run ends at any offset") {
+        for (auto k : kernels) {
+            if (!set_scan_kernel(k)) continue;
+            const auto sc = detail::make_scanner(k);
+
+            for (size_t i = 0; i < 80; i++) {
+                for (char c : { '"', '\\', '\t', '\n', '\r' }) {
+                    std::string str(i, 'x');
+                    str += c;
+                    str += std::string(40, 'x');
+                    REQUIRE(sc.string_end(str.data(), str.data() + str.size()) == str.data() + i);
+                }
+
+                std::string ws;
+                for (size_t j = 0; j < i; j++) ws += " \t\n\r"[j % 4];
+                REQUIRE(sc.whitespace_end(ws.data(), ws.data() + ws.size()) == ws.data() + ws.size());
+                ws += "{";
+                ws += std::string(40, ' ');
+                REQUIRE(sc.whitespace_end(ws.data(), ws.data() + ws.size()) == ws.data() + i);
+            }
+        }
+    }
+
+    SECTION("Same result with every kernel") {
+        const std::string value(1000, 'v');
+        const std::string in = R"(
+            {
+                "key"  :  ")" + value + R"(",
+                "array"   : [ "i1",    ")" + value + R"(" ],
+                "object" : {     "k" :    "v"     }
+            }
+        )";
+
+        for (auto k : kernels) {
+            if (!set_scan_kernel(k)) continue;
+
+            json js(in);
+            REQUIRE(js.is_valid());
+            REQUIRE(js.size() == 3);
+            REQUIRE(js["key"] == value);
+            REQUIRE(js.get_array("array").at(1) == value);
+            REQUIRE(js.get_object("object")["k"] == "v");
+
+            json escaped(R"({ "key" : ")" + value + R"(\"\\)" + value + R"(" })");
+            REQUIRE(escaped["key"] == value + "\"\\" + value);
+
+            json_view bad(R"({ "key" : "va
+lue" })");
+            REQUIRE_FALSE(bad.is_valid());
+
+            json_view partial(R"({ "key" : "value     )");
+            REQUIRE_FALSE(partial.is_valid());
+        }
+    }
+
+    SECTION("Non-ASCII characters") {
+        for (auto k : kernels) {
+            if (!set_scan_kernel(k)) continue;
+
+            json js("{ \"cl\xc3\xa9\" : \"\xe2\x82\xac 100 \x7f~\" }");
+            REQUIRE(js.is_valid());
+            REQUIRE(js["cl\xc3\xa9"] == "\xe2\x82\xac 100 \x7f~");
+        }
+    }
+
+    set_scan_kernel(active);
+}
+
+#ifdef MJSON_PMR
+TEST_CASE("Memory resource", "[pmr]") {
+    const std::string str(100, 'v');
+    const std::string_view value = str;
+    const std::string in = R"(
+        {
+            "key" : ")" + str + R"(",
+            "array" : [ ")" + str + R"(", "i2" ],
+            "object" : {
+                "objkey" : ")" + str + R"(",
+                "nested" : { "k" : ")" + str + R"(" }
+            }
+        }
+    )";
+
+    SECTION("The whole document is allocated from the arena") {
+        static char buffer[64 * 1024];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+        for (int i = 0; i < 3; i++) {
+            {
+                pmr::json js(in, &arena);
+                REQUIRE(js.is_valid());
+                REQUIRE(js.get_allocator().resource() == &arena);
+                REQUIRE(js["key"] == value);
+                REQUIRE(js.get_array("array").at(0) == value);
+
+                pmr::json& obj = js.get_object("object");
+                REQUIRE(obj.get_allocator().resource() == &arena);
+                REQUIRE(obj["objkey"] == value);
+                REQUIRE(obj.get_object("nested")["k"] == value);
+            }
+            arena.release();
+        }
+    }
+
+    SECTION("View") {
+        std::pmr::monotonic_buffer_resource arena;
+
+        pmr::json_view js(in, &arena);
+        REQUIRE(js.is_valid());
+        REQUIRE(js["key"] == value);
+        REQUIRE(js.get_object("object").get_object("nested")["k"] == value);
+    }
+
+    SECTION("Not valid") {
+        std::pmr::monotonic_buffer_resource arena;
+
+        pmr::json js(R"({ "key" : "value", )", &arena);
+        REQUIRE_FALSE(js.is_valid());
+        REQUIRE(js.size() == 0);
+    }
+}
+#endif
+
+TEST_CASE("Members", "[members]") {
+    SECTION("Document order") {
+        const auto in = R"(
+            {
+                "z" : "1",
+                "a" : [ "2" ],
+                "m" : { "k" : "3" },
+                "b" : "4"
+            }
+        )";
+
+        json js(in);
+        REQUIRE(js.is_valid());
+        REQUIRE(js.size() == 4);
+        REQUIRE(js.key(0) == "z");
+        REQUIRE(js.key(1) == "a");
+        REQUIRE(js.key(2) == "m");
+        REQUIRE(js.key(3) == "b");
+        REQUIRE(js.kind_of(0) == kind::string);
+        REQUIRE(js.kind_of(1) == kind::array);
+        REQUIRE(js.kind_of(2) == kind::object);
+        REQUIRE(js.kind_of(3) == kind::string);
+        REQUIRE(js.get(0) == "1");
+        REQUIRE(js.get_array(1).at(0) == "2");
+        REQUIRE(js.get_object(2)["k"] == "3");
+        REQUIRE(js.get(3) == "4");
+        REQUIRE(js.get(1) == "");
+    }
+
+    SECTION("Wide object") {
+        const size_t count = 1000;
+
+        std::string in = "{";
+        for (size_t i = 0; i < count; i++) {
+            const std::string n = std::to_string(i);
+            if (i) in += ",";
+            if (i % 3 == 0) in += "\"key" + n + "\" : \"value" + n + "\"";
+            if (i % 3 == 1) in += "\"key" + n + "\" : [ \"value" + n + "\" ]";
+            if (i % 3 == 2) in += "\"key" + n + "\" : { \"k\" : \"value" + n + "\" }";
+        }
+        in += "}";
+
+        json_view js(in);
+        REQUIRE(js.is_valid());
+        REQUIRE(js.size() == count);
+        for (size_t i = 0; i < count; i++) {
+            const std::string n = std::to_string(i);
+            REQUIRE(js.key(i) == "key" + n);
+            if (i % 3 == 0) REQUIRE(js.get("key" + n) == "value" + n);
+            if (i % 3 == 1) REQUIRE(js.get_array("key" + n).at(0) == "value" + n);
+            if (i % 3 == 2) REQUIRE(js.get_object("key" + n)["k"] == "value" + n);
+            REQUIRE(js.has("key" + n) == (i % 3 == 0));
+        }
+        REQUIRE_FALSE(js.has("key"));
+        REQUIRE_FALSE(js.has_array("key1000"));
+
+        json_view dup(in.substr(0, in.size() - 1) + R"(, "key999" : "" })");
+        REQUIRE_FALSE(dup.is_valid());
+    }
+
+    SECTION("Duplicate keys of different kinds") {
+        json js(R"({ "key" : "value", "key" : [] })");
+        REQUIRE_FALSE(js.is_valid());
+
+        json obj(R"({ "key" : {}, "key" : "value" })");
+        REQUIRE_FALSE(obj.is_valid());
+    }
+
+    SECTION("Missing keys are not inserted") {
+        json js(R"({ "key" : "value" })");
+        REQUIRE(js["missing"] == "");
+        REQUIRE(js.get_array("missing").empty());
+        REQUIRE(js.get_object("missing").size() == 0);
+        REQUIRE(js.get_object("key").size() == 0);
+        REQUIRE_FALSE(js.has("missing"));
+        REQUIRE(js.size() == 1);
+    }
+
+    SECTION("Const lookups") {
+        const json js(R"({ "key" : "value", "array" : [ "i1" ], "object" : { "k" : "v" },
+                          "list" : [ 1 ], "n" : 2.5, "b" : true })");
+        const std::string_view key = "key";
+
+        REQUIRE(js.find(key));
+        REQUIRE(*js.find(key) == "value");
+        REQUIRE(js[key] == "value");
+        REQUIRE(js.find_array("array")->at(0) == "i1");
+        REQUIRE((*js.find_object("object"))["k"] == "v");
+        REQUIRE(js.find_list("list")->get_number(0) == number(int64_t(1)));
+        REQUIRE(js.find_number("n")->as_double() == 2.5);
+        REQUIRE(*js.find_bool("b"));
+
+        REQUIRE_FALSE(js.find("missing"));
+        REQUIRE_FALSE(js.find("array"));
+        REQUIRE_FALSE(js.find_array("key"));
+        REQUIRE_FALSE(js.find_object("list"));
+        REQUIRE_FALSE(js.find_list("object"));
+        REQUIRE_FALSE(js.find_number("b"));
+        REQUIRE_FALSE(js.find_bool("n"));
+        REQUIRE(js.size() == 6);
+
+        // A lazy object is not parsed by a const lookup
+        json lazy(R"({ "object" : { "k" : "v" } })", options{ true });
+        REQUIRE_FALSE(std::as_const(lazy).find_object("object"));
+        REQUIRE(lazy.get_object("object")["k"] == "v");
+        REQUIRE(std::as_const(lazy).find_object("object"));
+    }
+
+    SECTION("Shared between threads") {
+        std::string in = "{";
+        for (int i = 0; i < 100; i++) in += (i ? ", \"" : "\"") + std::to_string(i) + R"(" : "v)" + std::to_string(i) + "\"";
+        in += "}";
+        const json js(in);
+
+        std::vector<std::thread> readers;
+        std::atomic<size_t> found{ 0 };
+        for (int t = 0; t < 4; t++) {
+            readers.emplace_back([&js, &found]() {
+                for (int i = 0; i < 200; i++) {
+                    const std::string n = std::to_string(i % 100);
+                    const std::string* v = js.find(n);
+                    if (v && *v == "v" + n && !js.find("x" + n)) ++found;
+                }
+            });
+        }
+        for (auto& t : readers) t.join();
+
+        REQUIRE(found == 800);
+        REQUIRE(js.size() == 100);
+    }
+}
+
+TEST_CASE("Key table", "[keys]") {
+    key_table keys;
+    const options opt{ false, default_max_depth, &keys };
+
+    std::string wide = R"({ "a\"b" : "q", "obj" : { "Device" : "d2" }, "list" : [ 1, "x" ])";
+    for (int i = 0; i < 20; i++) wide += R"(, "k)" + std::to_string(i) + R"(" : ")" + std::to_string(i) + "\"";
+    wide += R"(, "Device" : "d1" })";
+
+    SECTION("Keys are shared by the documents") {
+        json first(wide, opt);
+        json second(wide, opt);
+        REQUIRE(first.is_valid());
+        REQUIRE(keys.size() == 24);
+
+        REQUIRE(first.key(0) == "a\"b");
+        REQUIRE(first.key(0).data() == second.key(0).data());
+        REQUIRE(first.get_object("obj").key(0).data() == first.key(first.size() - 1).data());
+        REQUIRE(first["k7"] == "7");
+        REQUIRE(first.get_list("list").get(1) == "x");
+        json plain(wide);
+        REQUIRE(to_string(first) == to_string(plain));
+
+        REQUIRE_FALSE(json(R"({ "k1" : "a", "k1" : "b" })", opt).is_valid());
+    }
+
+    SECTION("Lookups by an interned key") {
+        const key_ref device = keys.intern("Device");
+        const key_ref missing = keys.intern("Missing");
+        REQUIRE(keys.intern("Device").name().data() == device.name().data());
+
+        json js(wide, opt);
+        REQUIRE(js[device] == "d1");
+        REQUIRE(js.get_object("obj")[device] == "d2");
+        REQUIRE_FALSE(js.has(missing));
+        REQUIRE(js.size() == 24);
+
+        // Any document finds it by its chars
+        json plain(wide);
+        json_view view(wide);
+        REQUIRE(plain[device] == "d1");
+        REQUIRE(view.get_object("obj")[device] == "d2");
+    }
+
+    SECTION("Views, lazy objects and parsers") {
+        json_view view(wide, opt);
+        REQUIRE(view.key(0).data() == keys.intern("a\"b").name().data());
+        REQUIRE(view["Device"] == "d1");
+
+        json lazy(wide, options{ true, default_max_depth, &keys });
+        REQUIRE(lazy.get_object("obj").key(0).data() == keys.intern("Device").name().data());
+
+        parser p(opt);
+        json js;
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(p.parse(wide, js));
+            REQUIRE(js.key(1).data() == keys.intern("obj").name().data());
+        }
+
+        stream_parser sp(opt);
+        sp.feed(wide);
+        REQUIRE(sp.finish().key(1).data() == keys.intern("obj").name().data());
+        REQUIRE(keys.size() == 24);
+    }
+
+    SECTION("A full table interns no more keys") {
+        key_table small(4);
+        const options capped{ false, default_max_depth, &small };
+        REQUIRE(small.intern("Device").interned());
+
+        json js(wide, capped);
+        json_view view(wide, capped);
+        REQUIRE(small.size() == 4);
+        REQUIRE_FALSE(small.intern("k19").interned());
+        REQUIRE(js.key(0).data() == small.intern("a\"b").name().data());
+
+        json plain(wide);
+        REQUIRE(to_string(js) == to_string(plain));
+        REQUIRE(to_string(view) == to_string(plain));
+        REQUIRE(js["k19"] == "19");
+        REQUIRE(view.get_object("obj")[small.intern("Device")] == "d2");
+        REQUIRE_FALSE(json(R"({ "k1" : "a", "k1" : "b" })", capped).is_valid());
+
+        // The keys past the table live as long as the document
+        json copy = js;
+        js = json();
+        REQUIRE(copy["k19"] == "19");
+        REQUIRE(to_string(copy) == to_string(plain));
+    }
+
+    SECTION("Shared between threads") {
+        std::vector<std::thread> parsers;
+        for (int t = 0; t < 4; t++)
+            parsers.emplace_back([&]() {
+                for (int i = 0; i < 50; i++) json(wide, opt);
+            });
+        for (auto& t : parsers) t.join();
+
+        REQUIRE(keys.size() == 24);
+        REQUIRE(json(wide, opt)["k19"] == "19");
+    }
+}
+
+TEST_CASE("Stream parser", "[stream]") {
+    using namespace mjson;
+
+    const std::string in = R"({ "Device" : "HeartMN1", "Image" : [ "PBS-09", "PBS-10" ],
+        "Firmware" : { "Version" : "1.123.900", "Update" : { "Server" : "https://update.com" } },
+        "Signature" : "e161fd8a" })";
+
+    SECTION("Split at every byte") {
+        for (size_t i = 0; i <= in.size(); i++) {
+            stream_parser p;
+            REQUIRE(p.feed(in.data(), i));
+            REQUIRE(p.feed(in.data() + i, in.size() - i));
+            REQUIRE(p.done());
+
+            json js = p.finish();
+            REQUIRE(js.is_valid());
+            REQUIRE(js["Device"] == "HeartMN1");
+            REQUIRE(js.get_array("Image") == json::Array{ "PBS-09", "PBS-10" });
+            REQUIRE(js.get_object("Firmware")["Version"] == "1.123.900");
+            REQUIRE(js.get_object("Firmware").get_object("Update")["Server"] == "https://update.com");
+            REQUIRE(js["Signature"] == "e161fd8a");
+        }
+    }
+
+    SECTION("One byte at a time") {
+        stream_parser p;
+        for (char c : in) REQUIRE(p.feed(&c, 1));
+
+        json js = p.finish();
+        REQUIRE(js.is_valid());
+        REQUIRE(js.size() == 4);
+        REQUIRE(js.get_object("Firmware").get_object("Update")["Server"] == "https://update.com");
+    }
+
+    SECTION("Invalid and unfinished input") {
+        stream_parser p;
+        REQUIRE(p.feed(R"({ "key" : "val)"));
+        REQUIRE_FALSE(p.done());
+        REQUIRE_FALSE(p.finish().is_valid());
+
+        REQUIRE_FALSE(p.feed(R"({ "key" : "value" ])"));
+        REQUIRE_FALSE(p.finish().is_valid());
+
+        REQUIRE(p.feed(R"({ "key" : "value" } trailing)"));
+        json js = p.finish();
+        REQUIRE(js.is_valid());
+        REQUIRE(js["key"] == "value");
+    }
+}
+
+TEST_CASE("Memory-mapped file", "[file]") {
+    const std::string path = "mjson_test_file.json";
+    {
+        std::ofstream f(path, std::ios::binary);
+        f << R"({ "Device" : "HeartMN1", "Image" : [ "PBS-09" ], "Firmware" : { "Version" : "1.9" } })";
+    }
+
+    SECTION("Json") {
+        json js = json::from_file(path);
+        REQUIRE(js.is_valid());
+        REQUIRE(js["Device"] == "HeartMN1");
+        REQUIRE(js.get_array("Image").at(0) == "PBS-09");
+        REQUIRE(js.get_object("Firmware")["Version"] == "1.9");
+    }
+
+    SECTION("View keeps the mapping") {
+        std::unique_ptr<json_view> js;
+        {
+            js = std::make_unique<json_view>(json_view::from_file(path));
+        }
+        std::remove(path.c_str());
+
+        REQUIRE(js->is_valid());
+        REQUIRE(js->get_object("Firmware")["Version"] == "1.9");
+        REQUIRE(js->key(0) == "Device");
+    }
+
+    SECTION("Missing and empty files") {
+        REQUIRE_FALSE(json::from_file("mjson_missing_file.json").is_valid());
+
+        { std::ofstream f(path, std::ios::binary); }
+        REQUIRE_FALSE(json_view::from_file(path).is_valid());
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Lazy objects", "[lazy]") {
+    const std::string in = R"({ "Device" : "HeartMN1",
+        "Firmware" : { "Version" : "1.9", "Note" : "{ } ]",
+                       "Update" : { "Server" : "https://update.com", "Auth" : [ "a", "b" ] } },
+        "Signature" : "e161fd8a" })";
+
+    SECTION("Json") {
+        json js(in, options{ true });
+        REQUIRE(js.is_valid());
+        REQUIRE(js.size() == 3);
+        REQUIRE(js.has_object("Firmware"));
+        REQUIRE(js["Signature"] == "e161fd8a");
+
+        json& frm = js.get_object("Firmware");
+        REQUIRE(frm.is_valid());
+        REQUIRE(frm["Version"] == "1.9");
+        REQUIRE(frm.get_object("Update").get_array("Auth") == json::Array{ "a", "b" });
+        REQUIRE(&js.get_object("Firmware") == &frm);
+    }
+
+    SECTION("View of a temporary string") {
+        json_view js(std::string(in), options{ true });
+        REQUIRE(js.is_valid());
+        REQUIRE(js.get_object(1).get_object("Update")["Server"] == "https://update.com");
+        REQUIRE(js.get_object(1).key(2) == "Update");
+    }
+
+    SECTION("Errors in a skipped object are found on access") {
+        json js(R"({ "a" : { "b" : "c" "d" : "e" }, "f" : "g" })", options{ true });
+        REQUIRE(js.is_valid());
+        REQUIRE(js["f"] == "g");
+        REQUIRE_FALSE(js.get_object("a").is_valid());
+
+        REQUIRE_FALSE(json(R"({ "a" : { "b" : "c
+" } })", options{ true }).is_valid());
+        REQUIRE_FALSE(json(R"({ "a" : { "b" : { "c" : "d" } })", options{ true }).is_valid());
+    }
+
+    SECTION("Const documents do not parse") {
+        json js(in, options{ true });
+        const json& c = js;
+        REQUIRE(c.has_object("Firmware"));
+        REQUIRE(c.get_object("Firmware").size() == 0);
+        REQUIRE(c.find_object("Firmware") == nullptr);
+        REQUIRE(to_string(c) == R"({"Device":"HeartMN1","Firmware":{},"Signature":"e161fd8a"})");
+
+        json& frm = js.get_object("Firmware");
+        REQUIRE(&c.get_object("Firmware") == &frm);
+        REQUIRE(c.get_object("Firmware")["Version"] == "1.9");
+        REQUIRE(c.get_object("Firmware").get_object("Update").size() == 0);
+    }
+}
+
+namespace {
+
+struct update_info {
+    std::string server;
+    std::string_view connection;
+    std::vector<std::string> client_auth;
+};
+
+struct firmware_info {
+    std::string_view version;
+    std::vector<std::string_view> image;
+    update_info update;
+    std::string md5;
+};
+
+struct device_info {
+    std::string device;
+    std::string_view id;
+    firmware_info firmware;
+};
+
+} // namespace
+
+template <>
+struct mjson::schema<update_info> {
+    static constexpr auto fields = std::make_tuple(
+        field("Server", &update_info::server),
+        field("Connection", &update_info::connection),
+        field("Client.Auth", &update_info::client_auth));
+};
+
+template <>
+struct mjson::schema<firmware_info> {
+    static constexpr auto fields = std::make_tuple(
+        field("Version", &firmware_info::version),
+        field("Image", &firmware_info::image),
+        field("Update", &firmware_info::update),
+        field("MD5", &firmware_info::md5));
+};
+
+template <>
+struct mjson::schema<device_info> {
+    static constexpr auto fields = std::make_tuple(
+        field("Device", &device_info::device),
+        field("ID", &device_info::id),
+        field("Firmware", &device_info::firmware));
+};
+
+struct reading {
+    std::string sensor;
+    double value = 0;
+    int64_t count = 0;
+    uint8_t level = 0;
+    bool ok = false;
+    std::string unit = "C";
+};
+
+template <>
+struct mjson::schema<reading> {
+    static constexpr auto fields = std::make_tuple(
+        field("Sensor", &reading::sensor),
+        field("Value", &reading::value),
+        field("Count", &reading::count),
+        field("Level", &reading::level),
+        field("Ok", &reading::ok),
+        field("Unit", &reading::unit));
+};
+
+TEST_CASE("Schema parser", "[schema]") {
+    const std::string in = R"({
+        "Device" : "HeartMN1", "ID" : "PAMF-0119239", "Class" : "Monitor",
+        "Firmware" : {
+            "Version" : "1.123.900", "Image" : [ "PBS-09", "PBS-10" ],
+            "Extra" : { "Nested" : { "Key" : "Value" }, "List" : [ "x" ] },
+            "Update" : { "Server" : "https://update.com", "Connection" : "mTLS",
+                         "Client.Auth" : [ "client1.der", "client2.der" ] },
+            "MD5" : "f598478b"
+        },
+        "Signature" : "e161fd8a"
+    })";
+
+    SECTION("Fields are filled and unknown members skipped") {
+        device_info d;
+        REQUIRE(parse_into(in, d));
+        REQUIRE(d.device == "HeartMN1");
+        REQUIRE(d.id == "PAMF-0119239");
+        REQUIRE(d.firmware.version == "1.123.900");
+        REQUIRE(d.firmware.image == std::vector<std::string_view>{ "PBS-09", "PBS-10" });
+        REQUIRE(d.firmware.update.server == "https://update.com");
+        REQUIRE(d.firmware.update.connection == "mTLS");
+        REQUIRE(d.firmware.update.client_auth == std::vector<std::string>{ "client1.der", "client2.der" });
+        REQUIRE(d.firmware.md5 == "f598478b");
+    }
+
+    SECTION("Members missing from the document keep their values") {
+        update_info u;
+        u.server = "default";
+        REQUIRE(parse_into(R"({ "Connection" : "TLS" })", u));
+        REQUIRE(u.server == "default");
+        REQUIRE(u.connection == "TLS");
+    }
+
+    SECTION("Kind mismatches, duplicates and syntax errors") {
+        update_info u;
+        REQUIRE_FALSE(parse_into(R"({ "Server" : [ "a" ] })", u));
+        REQUIRE_FALSE(parse_into(R"({ "Client.Auth" : "a" })", u));
+        REQUIRE_FALSE(parse_into(R"({ "Server" : { } })", u));
+        REQUIRE_FALSE(parse_into(R"({ "Server" : "a", "Server" : "b" })", u));
+        REQUIRE_FALSE(parse_into(R"({ "Server" : "a" )", u));
+        REQUIRE_FALSE(parse_into(R"({ "Other" : { "a" : "b" "c" : "d" } })", u));
+
+        device_info d;
+        REQUIRE_FALSE(parse_into(R"({ "Firmware" : "1.0" })", d));
+    }
+
+    SECTION("Numbers and booleans") {
+        reading r;
+        REQUIRE(parse_into(R"({ "Sensor" : "t1", "Value" : -12.5, "Count" : 42, "Level" : 7,
+                                "Ok" : true, "Skip" : [ 1, [ 2, { "a" : null } ] ], "Unit" : null })", r));
+        REQUIRE(r.sensor == "t1");
+        REQUIRE(r.value == -12.5);
+        REQUIRE(r.count == 42);
+        REQUIRE(r.level == 7);
+        REQUIRE(r.ok);
+        REQUIRE(r.unit == "C");
+
+        REQUIRE_FALSE(parse_into(R"({ "Count" : 1.5 })", r));
+        REQUIRE_FALSE(parse_into(R"({ "Level" : 300 })", r));
+        REQUIRE_FALSE(parse_into(R"({ "Level" : -1 })", r));
+        REQUIRE_FALSE(parse_into(R"({ "Ok" : 1 })", r));
+        REQUIRE_FALSE(parse_into(R"({ "Value" : "1" })", r));
+        REQUIRE_FALSE(parse_into(R"({ "Sensor" : 1 })", r));
+        REQUIRE(parse_into(R"({ "Value" : 3 })", r));
+        REQUIRE(r.value == 3.0);
+
+        update_info u;
+        REQUIRE_FALSE(parse_into(R"({ "Client.Auth" : [ "a", [ "b" ] ] })", u));
+        REQUIRE_FALSE(parse_into(R"({ "Client.Auth" : [ "a", 1 ] })", u));
+        REQUIRE_FALSE(parse_into(R"({ "Client.Auth" : [ { } ] })", u));
+    }
+
+    SECTION("Escapes") {
+        // A std::string_view field keeps the raw text
+        update_info u;
+        REQUIRE(parse_into(R"({ "Server" : "a\/b", "Connection" : "m\"TLS", "Client.Auth" : [ "\u0031" ] })", u));
+        REQUIRE(u.server == "a/b");
+        REQUIRE(u.connection == R"(m\"TLS)");
+        REQUIRE(u.client_auth == std::vector<std::string>{ "1" });
+        REQUIRE_FALSE(parse_into(R"({ "Server" : "\ud800" })", u));
+    }
+
+    SECTION("Matches the document parser") {
+        device_info d;
+        REQUIRE(parse_into(in, d));
+
+        json js(in);
+        REQUIRE(js["Device"] == d.device);
+        REQUIRE(js.get_object("Firmware").get_object("Update")["Server"] == d.firmware.update.server);
+    }
+}
+
+#ifdef MJSON_PMR
+TEST_CASE("Batch parsing", "[batch]") {
+    std::vector<std::string> in;
+    for (size_t i = 0; i < 1000; i++) {
+        const std::string n = std::to_string(i);
+        in.push_back(i % 7 == 6 ? "{ \"id\" : #" + n + " }"
+                                : R"({ "id" : ")" + n + R"(", "obj" : { "list" : [ "a", ")" + n + R"(" ] } })");
+    }
+    const std::vector<std::string_view> docs(in.begin(), in.end());
+
+    for (unsigned threads : { 1u, 2u, 3u, 8u, 0u }) {
+        batch b = parse_batch(docs, threads);
+        REQUIRE(b.size() == docs.size());
+
+        for (size_t i = 0; i < b.size(); i++) {
+            const std::string n = std::to_string(i);
+            if (i % 7 == 6) {
+                REQUIRE_FALSE(b[i].is_valid());
+                continue;
+            }
+            REQUIRE(b[i].is_valid());
+            REQUIRE(std::string_view(b[i]["id"]) == n);
+            REQUIRE(std::string_view(b[i].get_object("obj").get_array("list").at(1)) == n);
+        }
+    }
+
+    auto views = parse_batch<pmr::json_view>(docs.data(), 3, 4);
+    REQUIRE(views.size() == 3);
+    REQUIRE(views[2]["id"] == "2");
+    REQUIRE(views[2]["id"].data() >= in[2].data());
+
+    REQUIRE(parse_batch(docs.data(), 0).size() == 0);
+}
+#endif
+
+TEST_CASE("Parallel parsing", "[parallel]") {
+    // Quotes, braces, commas and backslash runs in strings around the chunk
+    // boundaries of all the thread counts
+    std::string in = "{";
+    for (size_t i = 0; i < 20000; i++) {
+        const std::string n = std::to_string(i);
+        in += i ? ",\n " : " ";
+        switch (i % 6) {
+        case 0: in += "\"s" + n + "\" : \"a\\\"},{\\\"b" + n + "\\\\\""; break;
+        case 1: in += "\"o" + n + "\" : { \"x\" : [ \"{\", \"}\" ], \"y\" : { \"z\" : -" + n + " } }"; break;
+        case 2: in += "\"l" + n + "\" : [ 1.5, [ \"\\\\\\\\\" ], { \"b\" : true }, null ]"; break;
+        case 3: in += "\"k\\u00e9" + n + "\" : " + n; break;
+        case 4: in += "\"a" + n + "\" : [ \"" + n + "\", \",\" ]"; break;
+        case 5: in += "\"t" + n + "\" : false"; break;
+        }
+    }
+    in += " }";
+
+    json expected(in);
+    REQUIRE(expected.is_valid());
+    const std::string text = to_string(expected);
+
+    SECTION("Same document on any number of threads") {
+        for (unsigned threads : { 1u, 2u, 3u, 5u, 8u, 0u }) {
+            json js = parse_parallel(in, threads);
+            REQUIRE(js.is_valid());
+            REQUIRE(js.size() == expected.size());
+            REQUIRE(to_string(js) == text);
+            REQUIRE(js.get_object("o19999").get_object("y").get_int("z") == -19999);
+        }
+    }
+
+    SECTION("View") {
+        json_view js = parse_parallel<json_view>(in, 4);
+        REQUIRE(js.is_valid());
+        REQUIRE(to_string(js) == text);
+        const char* item = js.get_array("a16").at(0).data();
+        REQUIRE((item >= in.data() && item < in.data() + in.size()));
+        REQUIRE(js["s12"] == "a\"},{\"b12\\");
+        REQUIRE(js.get_number("k\xc3\xa9" "15003").as_int() == 15003);
+        REQUIRE(js.get_list("l19994").get_array(1).at(0) == "\\\\");
+    }
+
+    SECTION("Key table") {
+        key_table keys;
+        json js = parse_parallel(in, 4, options{ false, default_max_depth, &keys });
+        REQUIRE(to_string(js) == text);
+        REQUIRE(js.has(keys.intern("s19998")));
+
+        key_table small(16);
+        json capped = parse_parallel(in, 4, options{ false, default_max_depth, &small });
+        REQUIRE(small.size() == 16);
+        REQUIRE(to_string(capped) == text);
+    }
+
+    SECTION("Invalid documents") {
+        const std::string bad[] = {
+            in.substr(0, in.size() - 1),
+            in.substr(0, in.size() / 2) + "," + in.substr(in.size() / 2),
+            in.substr(0, in.size() - 2) + ", \"s0\" : \"dup\" }",
+            in.substr(0, in.find(",", in.size() / 3)) + ", ," + in.substr(in.find(",", in.size() / 3) + 1),
+            "[" + in.substr(1),
+            in + " {",
+            R"({"a":"1"})" + std::string(600 * 1024, ' ') + R"({"b":"2", "c":"3"})",
+            in + std::string(600 * 1024, ' ') + R"({"b":"2", "c":"3"})",
+        };
+        for (auto& b : bad) {
+            json serial(b);
+            for (unsigned threads : { 2u, 4u, 7u }) {
+                json js = parse_parallel(b, threads);
+                REQUIRE(js.is_valid() == serial.is_valid());
+                REQUIRE(to_string(js) == to_string(serial));
+            }
+        }
+        REQUIRE_FALSE(parse_parallel(bad[2], 4).is_valid());
+
+        // The text after the outermost object is not parsed, like json does
+        json tail = parse_parallel(bad[6], 2);
+        REQUIRE(tail.is_valid());
+        REQUIRE(tail.size() == 1);
+        REQUIRE_FALSE(tail.has("c"));
+        json whole = parse_parallel(bad[7], 4);
+        REQUIRE(to_string(whole) == text);
+    }
+
+    SECTION("File") {
+        const std::string path = "mjson_test_parallel.json";
+        { std::ofstream f(path, std::ios::binary); f << in; }
+
+        json_view js = parse_parallel_file<json_view>(path, 4);
+        std::remove(path.c_str());
+        REQUIRE(js.is_valid());
+        REQUIRE(to_string(js) == text);
+        REQUIRE_FALSE(parse_parallel_file("mjson_missing_file.json").is_valid());
+    }
+}
+
+TEST_CASE("Document stream", "[documents]") {
+    const std::string log =
+        "{ \"id\" : \"0\", \"tags\" : [ \"a\" ] }\n"
+        "  { \"id\" : \"1\", \"obj\" : { \"k\" : \"{\" } }\r\n"
+        "{ \"id\" : \"2\" }{ \"id\" : \"3\" }\n"
+        "{ \"id\" : \"4\" \"broken\" : \"\" }\n"
+        "\n"
+        "{ \"id\" : \"5\" }\n"
+        "{ \"id\" : \"6\", \"unfinished\" : ";
+
+    SECTION("Json") {
+        document_stream ds(log);
+        std::vector<std::string> ids;
+        size_t invalid = 0;
+        for (json& js : ds) {
+            if (js.is_valid()) ids.push_back(js["id"]);
+            else invalid++;
+        }
+
+        REQUIRE(ids == std::vector<std::string>{ "0", "1", "2", "3", "5" });
+        REQUIRE(invalid == 2);
+    }
+
+    SECTION("View") {
+        document_view_stream ds(log);
+        REQUIRE(ds.next());
+        REQUIRE(ds.offset() == 0);
+        REQUIRE(ds.document().get_array("tags").at(0) == "a");
+        REQUIRE(ds.next());
+        REQUIRE(ds.document().get_object("obj")["k"] == "{");
+        REQUIRE(ds.document().key(1) == "obj");
+        REQUIRE(ds.next());
+        REQUIRE(log.substr(ds.offset(), 14) == "{ \"id\" : \"2\" }");
+        REQUIRE(ds.document()["id"] == "2");
+    }
+
+    SECTION("Split at record boundaries") {
+        auto docs = split_documents(log);
+        REQUIRE(docs.size() == 7);
+        REQUIRE(docs[2] == "{ \"id\" : \"2\" }");
+        REQUIRE(docs[3] == "{ \"id\" : \"3\" }");
+
+        for (size_t i = 0; i < docs.size(); i++) {
+            json js(docs[i]);
+            REQUIRE(js.is_valid() == (i != 4 && i != 6));
+        }
+    }
+
+    SECTION("File") {
+        const std::string path = "mjson_test_log.json";
+        {
+            std::ofstream f(path, std::ios::binary);
+            f << log;
+        }
+
+        size_t count = 0;
+        {
+            auto ds = document_view_stream::from_file(path);
+            for (auto& js : ds) count += js.is_valid();
+        }
+        std::remove(path.c_str());
+        REQUIRE(count == 5);
+
+        REQUIRE(document_stream::from_file(path).begin() == document_stream::iterator());
+    }
+}
+
+#ifdef MJSON_STATS
+namespace {
+size_t stats_calls = 0;
+size_t stats_bytes = 0;
+size_t stats_transitions = 0;
+}
+
+TEST_CASE("Parse statistics", "[stats]") {
+    const std::string in = R"({ "a" : "1", "long" : "a value longer than the inline string buffer",
+        "list" : [ "x", "y" ], "obj" : { "b" : "2", "deep" : { } } })";
+
+    set_stats_callback([](const parse_stats& st, std::string_view input) {
+        stats_calls++;
+        stats_bytes += input.size();
+        stats_transitions += st.transitions;
+    });
+
+    json js(in);
+    REQUIRE(js.is_valid());
+    set_stats_callback(nullptr);
+
+    const parse_stats& st = js.stats();
+    REQUIRE(stats_calls == 1);
+    REQUIRE(stats_bytes == in.size());
+    REQUIRE(stats_transitions == js.stats().transitions);
+
+    REQUIRE(st.bytes_scanned == in.size());
+    REQUIRE(st.transitions > 0);
+    REQUIRE(st.transitions < in.size());
+    REQUIRE(st.max_depth == 3);
+    REQUIRE(st.actions[parse_stats::object_begin] == 3);
+    REQUIRE(st.actions[parse_stats::object_end] == 3);
+    REQUIRE(st.actions[parse_stats::key_start] == 6);
+    REQUIRE(st.actions[parse_stats::key_end] == 6);
+    REQUIRE(st.actions[parse_stats::value_start] == 5);
+    REQUIRE(st.actions[parse_stats::value_end] == 5);
+    REQUIRE(st.actions[parse_stats::array_begin] == 1);
+    REQUIRE(st.actions[parse_stats::array_end] == 1);
+    REQUIRE(st.allocations > 0);
+    REQUIRE(st.bytes_allocated > 0);
+
+    json lazy(in, options{ true });
+    REQUIRE(lazy.stats().actions[parse_stats::object_skipped] == 1);
+    REQUIRE(lazy.stats().max_depth == 2);
+
+    json_view view(in);
+    REQUIRE(view.stats().allocations < st.allocations);
+}
+#endif
+
+TEST_CASE("Writer", "[writer]") {
+    const std::string in = R"({ "Device" : "HeartMN1", "Image" : [ "PBS-09", "PBS-10" ], "Empty" : [ ],
+        "Firmware" : { "Version" : "1.9", "Update" : { "Server" : "https://update.com" }, "None" : { } } })";
+
+    SECTION("Compact") {
+        json js(in);
+        const std::string out = to_string(js);
+        REQUIRE(out == R"({"Device":"HeartMN1","Image":["PBS-09","PBS-10"],"Empty":[],)"
+                       R"("Firmware":{"Version":"1.9","Update":{"Server":"https://update.com"},"None":{}}})");
+        REQUIRE(writer::measure(js) == out.size());
+    }
+
+    SECTION("Pretty") {
+        json js(in);
+        const std::string out = to_string(js, writer::pretty, 2);
+        REQUIRE(out ==
+            "{\n"
+            "  \"Device\": \"HeartMN1\",\n"
+            "  \"Image\": [\n"
+            "    \"PBS-09\",\n"
+            "    \"PBS-10\"\n"
+            "  ],\n"
+            "  \"Empty\": [],\n"
+            "  \"Firmware\": {\n"
+            "    \"Version\": \"1.9\",\n"
+            "    \"Update\": {\n"
+            "      \"Server\": \"https://update.com\"\n"
+            "    },\n"
+            "    \"None\": {}\n"
+            "  }\n"
+            "}");
+        REQUIRE(writer::measure(js, writer::pretty, 2) == out.size());
+    }
+
+    SECTION("Values") {
+        const std::string values = R"({ "n" : [ 1, -2.5, 1e300, [ 3.0, [ ] ], { "b" : true } ], "f" : false, "z" : null })";
+        json js(values);
+        const std::string out = to_string(js);
+        REQUIRE(out == R"({"n":[1,-2.5,1e+300,[3.0,[]],{"b":true}],"f":false,"z":null})");
+        REQUIRE(writer::measure(js) == out.size());
+
+        const std::string pretty = to_string(js, writer::pretty);
+        REQUIRE(writer::measure(js, writer::pretty) == pretty.size());
+        json back(pretty);
+        REQUIRE(to_string(back) == out);
+
+        std::string streamed;
+        writer(streamed).begin_object().key("i").value(7).key("d").value(0.5).key("u").value(2u)
+            .key("b").value(true).key("s").value("x").key("z").null()
+            .key("inf").value(std::numeric_limits<double>::infinity()).end_object();
+        REQUIRE(streamed == R"({"i":7,"d":0.5,"u":2,"b":true,"s":"x","z":null,"inf":null})");
+
+        std::string unsigned_values;
+        writer(unsigned_values).begin_array().value(uint64_t(1) << 63).value(UINT64_MAX)
+            .value(uint8_t(255)).value(-1).end_array();
+        REQUIRE(unsigned_values == "[9223372036854775808,18446744073709551615,255,-1]");
+    }
+
+    SECTION("Round trip") {
+        json js(in);
+        for (auto m : { writer::compact, writer::pretty }) {
+            json back(to_string(js, m));
+            REQUIRE(back.is_valid());
+            REQUIRE(to_string(back) == to_string(js));
+            REQUIRE(back.get_object("Firmware").get_object("Update")["Server"] == "https://update.com");
+        }
+
+        json_view view(in);
+        REQUIRE(to_string(view) == to_string(js));
+    }
+
+    SECTION("Streamed calls and escapes") {
+        std::string out = "prefix:";
+        writer w(out);
+        w.begin_object()
+            .key("quote\"").value("back\\slash")
+            .key("ctl").value(std::string_view("a\nb\tc\x01\x1f", 7))
+            .key("list").begin_array().value("x").begin_object().end_object().end_array()
+        .end_object();
+
+        REQUIRE(out == R"(prefix:{"quote\"":"back\\slash","ctl":"a\nb\tc\u0001\u001f","list":["x",{}]})");
+    }
+
+    SECTION("Escapes at any position of a long run") {
+        for (size_t i = 0; i < 24; i++) {
+            for (char c : { '"', '\\', '\n', '\x7f', '\x80' }) {
+                std::string v(24, 'v');
+                v[i] = c;
+
+                std::string out;
+                writer(out).value(v);
+
+                std::string expected = v;
+                if (c == '"') expected.replace(i, 1, "\\\"");
+                if (c == '\\') expected.replace(i, 1, "\\\\");
+                if (c == '\n') expected.replace(i, 1, "\\n");
+                REQUIRE(out == '"' + expected + '"');
+            }
+        }
+    }
+}
+
+TEST_CASE("Reusable parser", "[parser]") {
+    const std::string long_value(100, 'v');
+    const std::string docs[] = {
+        R"({ "a" : ")" + long_value + R"(", "list" : [ "x", "y" ], "obj" : { "b" : { "c" : "d" } } })",
+        R"({ "e" : "f", "obj" : { "g" : "h" }, "list" : [ ")" + long_value + R"(" ] })",
+        R"({ "list" : [ "x" )",
+        R"({ "a" : ")" + long_value + R"(", "list" : [ "x", "y" ], "obj" : { "b" : { "c" : "d" } } })",
+    };
+
+    SECTION("Json") {
+        parser p;
+        json js;
+
+        REQUIRE(p.parse(docs[0], js));
+        REQUIRE(js["a"] == long_value);
+        REQUIRE(js.get_object("obj").get_object("b")["c"] == "d");
+
+        REQUIRE(p.parse(docs[1], js));
+        REQUIRE(js.size() == 3);
+        REQUIRE_FALSE(js.has("a"));
+        REQUIRE(js["e"] == "f");
+        REQUIRE(js.get_object("obj")["g"] == "h");
+        REQUIRE_FALSE(js.get_object("obj").has_object("b"));
+        REQUIRE(js.get_array("list") == json::Array{ long_value });
+
+        REQUIRE_FALSE(p.parse(docs[2], js));
+        REQUIRE(js.size() == 0);
+
+        REQUIRE(p.parse(docs[3], js));
+        json fresh(docs[0]);
+        REQUIRE(to_string(js) == to_string(fresh));
+    }
+
+    SECTION("View") {
+        view_parser p;
+        json_view js;
+        for (auto& d : docs) {
+            REQUIRE(p.parse(d, js) == json_view(d).is_valid());
+            json fresh(d);
+            if (js.is_valid()) REQUIRE(to_string(js) == to_string(fresh));
+        }
+    }
+
+    SECTION("Stream parser recovers after an error in an array") {
+        stream_parser sp;
+        REQUIRE_FALSE(sp.feed(R"({ "list" : [ "x" } })"));
+        REQUIRE_FALSE(sp.finish().is_valid());
+
+        REQUIRE(sp.feed(R"({ "a" : "b" })"));
+        REQUIRE(sp.finish()["a"] == "b");
+    }
+
+#ifdef MJSON_STATS
+    SECTION("Storage is reused") {
+        parser p;
+        json js;
+        REQUIRE(p.parse(docs[0], js));
+        REQUIRE(js.stats().allocations > 0);
+        REQUIRE(p.parse(docs[0], js));
+        REQUIRE(js.stats().allocations == 0);
+    }
+#endif
+}
+
+TEST_CASE("Config snapshot", "[snapshot]") {
+    SECTION("Reload") {
+        config_snapshot cfg;
+        REQUIRE(cfg.version() == 0);
+        REQUIRE_FALSE(cfg.load()->is_valid());
+
+        REQUIRE(cfg.reload(R"({ "Server" : "a" })"));
+        config_snapshot::reader r(cfg);
+        REQUIRE(r->get("Server") == "a");
+
+        // The version a caller holds does not change
+        auto first = cfg.load();
+        REQUIRE(cfg.reload(R"({ "Server" : "b" })"));
+        REQUIRE((*first)["Server"] == "a");
+        REQUIRE(r->get("Server") == "b");
+        REQUIRE(cfg.version() == 2);
+
+        REQUIRE_FALSE(cfg.reload(R"({ "Server" : )"));
+        REQUIRE(cfg.version() == 2);
+        REQUIRE(r->get("Server") == "b");
+    }
+
+    SECTION("Old versions are released") {
+        config_snapshot cfg(R"({ "v" : 1 })");
+        config_snapshot::reader r(cfg);
+        REQUIRE(r->get_int("v") == 1);
+
+        std::weak_ptr<const json> old = cfg.load();
+        cfg.reload(R"({ "v" : 2 })");
+        REQUIRE_FALSE(old.expired());
+
+        REQUIRE(r->get_int("v") == 2);
+        REQUIRE(old.expired());
+    }
+
+    SECTION("Lazy option does not apply") {
+        config_snapshot cfg(R"({ "o" : { "k" : "v" } })", options{ true });
+        REQUIRE(cfg.load()->find_object("o"));
+    }
+
+    SECTION("Readers during reloads") {
+        config_snapshot cfg(R"({ "v" : 0, "copy" : 0 })");
+        std::atomic<bool> done{ false };
+        std::atomic<size_t> torn{ 0 };
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; t++) {
+            readers.emplace_back([&]() {
+                config_snapshot::reader r(cfg);
+                int64_t last = 0;
+                while (!done) {
+                    const json& js = *r;
+                    const int64_t v = js.get_int("v");
+                    if (v != js.get_int("copy") || v < last) ++torn;
+                    last = v;
+                }
+            });
+        }
+
+        for (int i = 1; i <= 200; i++) {
+            const std::string n = std::to_string(i);
+            REQUIRE(cfg.reload(R"({ "v" : )" + n + R"(, "copy" : )" + n + " }"));
+        }
+        done = true;
+        for (auto& t : readers) t.join();
+
+        REQUIRE(torn == 0);
+        REQUIRE(cfg.load()->get_int("v") == 200);
+        REQUIRE(cfg.load().use_count() == 2);
+    }
+
+    SECTION("File") {
+        const std::string path = "mjson_test_snapshot.json";
+        { std::ofstream f(path, std::ios::binary); f << R"({ "Server" : "c" })"; }
+
+        config_snapshot cfg;
+        REQUIRE(cfg.reload_file(path));
+        REQUIRE((*cfg.load())["Server"] == "c");
+        REQUIRE_FALSE(cfg.reload_file("mjson_missing_file.json"));
+        REQUIRE((*cfg.load())["Server"] == "c");
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("Binary form", "[binary]") {
+    const std::string in = R"({ "Device" : "Heart\"MN1", "Image" : [ "PBS-09", "PBS-10" ], "Empty" : [ ],
+        "Firmware" : { "Version" : "1.9", "Update" : { "Server" : "https://update.com" }, "None" : { } },
+        "n" : -42, "d" : 2.5, "t" : true, "f" : false, "z" : null, "l" : [ 1, [ "x" ], { "b" : true } ] })";
+
+    SECTION("Round trip") {
+        json js(in);
+        const std::string data = save_binary(js);
+        binary_view bin = load_binary(data);
+        REQUIRE(bin.is_valid());
+        REQUIRE(bin.size() == js.size());
+        for (size_t i = 0; i < js.size(); i++) {
+            REQUIRE(bin.key(i) == js.key(i));
+            REQUIRE(bin.kind_of(i) == js.kind_of(i));
+        }
+
+        REQUIRE(bin["Device"] == "Heart\"MN1");
+        REQUIRE(bin.get_array("Image").size() == 2);
+        REQUIRE(bin.get_array("Image")[1] == "PBS-10");
+        REQUIRE(bin.get_array("Empty").empty());
+        REQUIRE(bin.get_object("Firmware")["Version"] == "1.9");
+        REQUIRE(bin.get_object("Firmware").get_object("Update")["Server"] == "https://update.com");
+        REQUIRE(bin.get_object("Firmware").get_object("None").size() == 0);
+        REQUIRE(bin.get_int("n") == -42);
+        REQUIRE(bin.get_number("n").is_integer());
+        REQUIRE(bin.get_double("d") == 2.5);
+        REQUIRE(bin.get_bool("t"));
+        REQUIRE(bin.has_bool("f"));
+        REQUIRE_FALSE(bin.get_bool("f"));
+        REQUIRE(bin.is_null("z"));
+
+        binary_view l = bin.get_list("l");
+        REQUIRE(l.size() == 3);
+        REQUIRE(l.get_number(0).as_int() == 1);
+        REQUIRE(l.get_array(1).at(0) == "x");
+        REQUIRE(l.get_object(2).get_bool("b"));
+
+        std::string items;
+        for (auto v : bin.get_array("Image")) items += std::string(v) + ",";
+        REQUIRE(items == "PBS-09,PBS-10,");
+    }
+
+    SECTION("Arrays of temporary objects") {
+        json fw(R"({ "F" : { "I" : [ "PBS-09", "PBS-10" ] } })");
+        binary_view image = load_binary(save_binary(fw));
+        REQUIRE(image.get_object("F").get_array("I")[0] == "PBS-09");
+
+        // The array outlives the objects it is taken from
+        binary_view::array img = image.get_object("F").get_array("I");
+        REQUIRE(img.size() == 2);
+        REQUIRE(img[1] == "PBS-10");
+
+        json js(in);
+        binary_view bin = load_binary(save_binary(js));
+        binary_view::array list = bin.get_list("l").get_array(1);
+        REQUIRE(list[0] == "x");
+        REQUIRE(bin.get_list("l").get_array(1)[0] == "x");
+
+        std::string items;
+        for (auto v : load_binary(save_binary(js)).get_array("Image")) items += std::string(v) + ",";
+        REQUIRE(items == "PBS-09,PBS-10,");
+    }
+
+    SECTION("Size limit") {
+        json js(in);
+        const std::string data = save_binary(js);
+
+        std::string out;
+        REQUIRE(detail::binary_writer<json>(out, data.size()).write(js));
+        REQUIRE(out == data);
+        REQUIRE_FALSE(detail::binary_writer<json>(out, data.size() - 1).write(js));
+        REQUIRE(out.empty());
+        REQUIRE_FALSE(load_binary(out).is_valid());
+    }
+
+    SECTION("Missing members") {
+        json js(in);
+        const std::string data = save_binary(js);
+        binary_view bin = load_binary(data);
+        REQUIRE_FALSE(bin.has("Missing"));
+        REQUIRE(bin["Missing"].empty());
+        REQUIRE_FALSE(bin.has("Image"));
+        REQUIRE(bin.get_array("Device").empty());
+        REQUIRE(bin.get_object("Image").size() == 0);
+        REQUIRE(bin.get_array("Image").at(5).empty());
+        REQUIRE(bin.get(size_t(100)).empty());
+    }
+
+    SECTION("Wide objects") {
+        std::string wide = "{";
+        for (int i = 0; i < 100; i++) wide += (i ? "," : "") + std::string("\"k") + std::to_string(i) + "\":" + std::to_string(i);
+        wide += "}";
+
+        json js(wide);
+        binary_view bin = load_binary(save_binary(js));
+        REQUIRE(bin.size() == 100);
+        for (int i = 0; i < 100; i++) REQUIRE(bin.get_int("k" + std::to_string(i)) == i);
+        REQUIRE_FALSE(bin.has_number("k100"));
+    }
+
+    SECTION("Lazy objects") {
+        json js(in, options{ true });
+        binary_view bin = load_binary(save_binary(js));
+        REQUIRE(bin.get_object("Firmware").get_object("Update")["Server"] == "https://update.com");
+    }
+
+    SECTION("File") {
+        const std::string path = "mjson_test_file.mjsb";
+        {
+            json js(in);
+            std::ofstream f(path, std::ios::binary);
+            f << save_binary(js);
+        }
+
+        binary_view fw;
+        {
+            binary_view bin = binary_view::from_file(path);
+            REQUIRE(bin.is_valid());
+            fw = bin.get_object("Firmware");
+        }
+        std::remove(path.c_str());
+        REQUIRE(fw["Version"] == "1.9");
+
+        REQUIRE_FALSE(binary_view::from_file("mjson_missing_file.mjsb").is_valid());
+    }
+
+    SECTION("Invalid data") {
+        REQUIRE_FALSE(load_binary(std::string_view()).is_valid());
+        REQUIRE_FALSE(load_binary(in).is_valid());
+
+        json js(in);
+        const std::string data = save_binary(js);
+        for (size_t n = 0; n < data.size(); n++) {
+            binary_view bin = load_binary(std::string(data, 0, n));
+            REQUIRE_FALSE(bin.is_valid());
+            REQUIRE(bin.size() == 0);
+        }
+
+        // Damaged words read as missing members, never out of the buffer
+        for (size_t i = 16; i + 4 <= data.size(); i += 4) {
+            std::string bad = data;
+            const uint32_t v = 0xfffffff0;
+            std::memcpy(&bad[i], &v, 4);
+            binary_view bin = load_binary(std::move(bad));
+            for (size_t j = 0; j < bin.size(); j++) {
+                bin.key(j);
+                bin.get(j);
+                for (auto v : bin.get_array(j)) REQUIRE(v.size() <= data.size());
+                binary_view o = bin.get_object(j);
+                for (size_t k = 0; k < o.size(); k++) o.get(k);
+            }
+            bin.get_object("Firmware").get("Version");
+        }
+    }
+}
+
+namespace {
+
+// Records the events as text
+struct recorder : sax_handler {
+    std::string events;
+
+    bool on_object_begin() { events += "{"; return true; }
+    bool on_object_end() { events += "}"; return true; }
+    bool on_key(std::string_view key) { events += "k:" + std::string(key) + " "; return true; }
+    bool on_string(std::string_view value) { events += "s:" + std::string(value) + " "; return true; }
+    bool on_number(number value) { events += "n:" + std::to_string(value.as_double()) + " "; return true; }
+    bool on_bool(bool value) { events += value ? "true " : "false "; return true; }
+    bool on_null() { events += "null "; return true; }
+    bool on_array_begin() { events += "["; return true; }
+    bool on_array_end() { events += "]"; return true; }
+};
+
+struct router : sax_handler {
+    bool next = false;
+    size_t keys = 0;
+    std::string_view route;
+
+    bool on_key(std::string_view key) {
+        keys++;
+        next = key == "Route";
+        return true;
+    }
+
+    bool on_string(std::string_view value) {
+        if (next) route = value;
+        return !next;
+    }
+};
+
+} // namespace
+
+TEST_CASE("SAX interface", "[sax]") {
+    SECTION("Events") {
+        const std::string msg = R"({ "a" : "b", "list" : [ "x", "y" ], "obj" : { "c" : "d" } } trailing)";
+        recorder r;
+        auto res = sax_parse(msg, r);
+        REQUIRE(res.valid);
+        REQUIRE_FALSE(res.stopped);
+        REQUIRE(res.offset == msg.find(" trailing"));
+        REQUIRE(r.events == "{k:a s:b k:list [s:x s:y ]k:obj {k:c s:d }}");
+    }
+
+    SECTION("Values") {
+        recorder r;
+        REQUIRE(sax_parse(R"({ "a" : [ 1, [ true ], { "b" : null } ], "c" : -0.5 })", r));
+        REQUIRE(r.events == "{k:a [n:1.000000 [true ]{k:b null }]k:c n:-0.500000 }");
+    }
+
+    SECTION("Escapes are decoded") {
+        recorder r;
+        REQUIRE(sax_parse(R"({ "a\"" : [ "\u00e9\\" ] })", r));
+        REQUIRE(r.events == "{k:a\" [s:\xc3\xa9\\ ]}");
+    }
+
+    SECTION("Handler without events") {
+        sax_handler h;
+        REQUIRE(sax_parse(R"({ "a" : { "b" : [ "c" ] } })", h));
+        REQUIRE_FALSE(sax_parse(R"({ "a" : { "b" : [ "c" ] })", h));
+    }
+
+    SECTION("Early stop") {
+        const std::string msg = R"({ "Type" : "event", "Route" : "queue.7", "Body" : { "k" : "v" }, "Tail" : "x" })";
+        router r;
+        auto res = sax_parse(msg, r);
+        REQUIRE_FALSE(res.valid);
+        REQUIRE(res.stopped);
+        REQUIRE(r.route == "queue.7");
+        REQUIRE(r.keys == 2);
+        REQUIRE(msg.substr(res.offset, 2) == ", ");
+    }
+
+    SECTION("Stop on a scalar") {
+        // Stops on the n-th event of a number, a literal or a string
+        struct stopper : sax_handler {
+            int left;
+            bool next() { return --left > 0; }
+            bool on_number(number) { return next(); }
+            bool on_bool(bool) { return next(); }
+            bool on_null() { return next(); }
+            bool on_string(std::string_view) { return next(); }
+        };
+
+        const std::string msg = R"({"a":12,"b":"xy","c":true})";
+        const size_t ends[] = { 7, 16, 25 };
+        for (int n = 1; n <= 3; n++) {
+            stopper h;
+            h.left = n;
+            auto res = sax_parse(msg, h);
+            REQUIRE(res.stopped);
+            REQUIRE(res.offset == ends[n - 1]);
+        }
+
+        stopper h;
+        h.left = 1;
+        REQUIRE(sax_parse(R"({ "a" : [ null , 1 ] })", h).offset == 14);
+    }
+
+    SECTION("Syntax error") {
+        recorder r;
+        auto res = sax_parse(R"({ "a" : "b" "c" : "d" })", r);
+        REQUIRE_FALSE(res.valid);
+        REQUIRE_FALSE(res.stopped);
+        REQUIRE(res.offset == 12);
+    }
+}
+
+TEST_CASE("Path extraction", "[extract]") {
+    const std::string in = R"({
+        "Device" : "HeartMN1",
+        "Other" : { "Update" : { "Server" : "wrong" }, "deep" : { "x" : { "y" : "z" } } },
+        "Firmware" : {
+            "Version" : "1.123.900",
+            "Image" : [ "PBS-09", "PBS-10" ],
+            "Update" : { "Server" : "https://update.com", "Connection" : "mTLS" }
+        },
+        "Signature" : "e161fd8a"
+    })";
+
+    SECTION("Single path") {
+        REQUIRE(extract(in, { "Firmware", "Update", "Server" }) == "https://update.com");
+        REQUIRE(extract(in, { "Device" }) == "HeartMN1");
+        REQUIRE(extract(in, { "Signature" }) == "e161fd8a");
+        REQUIRE(extract(in, { "Other", "deep", "x", "y" }) == "z");
+
+        REQUIRE_FALSE(extract(in, { "Firmware", "Update", "Missing" }));
+        REQUIRE_FALSE(extract(in, { "Firmware", "Image" }));
+        REQUIRE_FALSE(extract(in, { "Firmware" }));
+        REQUIRE_FALSE(extract(in, { "Device", "Server" }));
+        REQUIRE_FALSE(extract(in, {}));
+    }
+
+    SECTION("Multiple paths") {
+        auto v = extract_all(in, { { "Signature" }, { "Firmware", "Version" }, { "Nope" },
+                               { "Firmware", "Update", "Connection" }, { "Device" } });
+        REQUIRE(v.size() == 5);
+        REQUIRE(v[0] == "e161fd8a");
+        REQUIRE(v[1] == "1.123.900");
+        REQUIRE_FALSE(v[2]);
+        REQUIRE(v[3] == "mTLS");
+        REQUIRE(v[4] == "HeartMN1");
+    }
+
+    SECTION("Matches the document") {
+        json js(in);
+        REQUIRE(extract(in, { "Firmware", "Update", "Server" }) ==
+                std::string_view(js.get_object("Firmware").get_object("Update")["Server"]));
+    }
+
+    SECTION("Numbers and arrays") {
+        const auto doc = R"({ "n" : 1, "l" : [ { "a" : "in list" }, [ "x" ] ], "a" : "top" })";
+        REQUIRE(extract(doc, { "a" }) == "top");
+        REQUIRE_FALSE(extract(doc, { "n" }));
+        REQUIRE_FALSE(extract(doc, { "l", "a" }));
+    }
+
+    SECTION("Escapes") {
+        // Keys are matched decoded and values are returned raw
+        const auto doc = R"({ "s\"k" : { "\u0078" : "a\nb" }, "o" : { "k" : "}\"{" }, "v" : "w" })";
+        REQUIRE(extract(doc, { "s\"k", "x" }) == R"(a\nb)");
+        REQUIRE(unescape(*extract(doc, { "s\"k", "x" })) == "a\nb");
+        REQUIRE(extract(doc, { "v" }) == "w");
+        REQUIRE_FALSE(extract(R"({ "a" : "\q" })", { "a" }));
+    }
+
+    SECTION("Invalid documents") {
+        // The parse stops at the value
+        REQUIRE(extract(R"({ "a" : { "b" : "c" )", { "a", "b" }) == "c");
+        REQUIRE_FALSE(extract(R"({ "x" "a" : "b" })", { "a" }));
+        REQUIRE_FALSE(extract(R"({ "x" : { "y" : "
+" }, "a" : "b" })", { "a" }));
+        REQUIRE_FALSE(extract_all(R"({ "a" : "b" )", { { "a" }, { "c" } })[0]);
+    }
+}